@@ -0,0 +1,156 @@
+/**
+ * Bulk preparing benchmark, prepares and validates a large set of scripts
+ * with one thread, then with a batch worked on by several threads.
+ *
+ * Build and run:
+ *   cc -O2 -pthread -o bench_bulk bench_bulk.c && ./bench_bulk [count] [threads] [script...]
+ *
+ * Script files given are loaded round-robin, otherwise scripts are
+ * generated.
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://sam.zoy.org/wtfpl/COPYING for more details.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <pthread.h>
+#include <time.h>
+
+#include "xpl.h"
+
+typedef struct worker_t {
+  pthread_t thread;
+  xpl_batch_t* batch;
+  xpl_context_t context;
+  int index;
+} worker_t;
+
+static xpl_config_t config;
+
+static xpl_status_t rule(xpl_context_t* _s) {
+  while(xpl_has_param(_s) == XS_OK) xpl_skip_string(_s);
+
+  return XS_OK;
+}
+
+static xpl_status_t hit(xpl_context_t* _s) {
+  return xpl_push_bool(_s, _s->userdata != NULL);
+}
+
+static char* load_text(const char* _n) {
+  FILE* fp = NULL;
+  char* ret = NULL;
+  long l = 0;
+  if(!(fp = fopen(_n, "rb"))) return NULL;
+  fseek(fp, 0, SEEK_END);
+  l = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  ret = (char*)malloc(l + 1);
+  l = (long)fread(ret, 1, l, fp);
+  ret[l] = '\0';
+  fclose(fp);
+
+  return ret;
+}
+
+static char* make_text(int _i) {
+  char* ret = (char*)malloc(512);
+  sprintf(ret,
+    "'rule %d' if hit then rule %d \"matched\" elseif hit then rule 0 else rule -%d endif "
+    "store 0 %d switch 0 case %d rule \"a\" case %d rule \"b\" default rule \"c\" endswitch "
+    "repeat 3 while hit do rule %d endwhile endrepeat if hit then rule 1 endif", _i, _i, _i, _i % 7, _i % 7, _i % 7 + 1, _i);
+
+  return ret;
+}
+
+static void* work(void* _p) {
+  worker_t* w = (worker_t*)_p;
+  xpl_batch_work(w->batch, &w->context, w->index);
+
+  return NULL;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[]) {
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("rule", rule)
+    XPL_FUNC_ADD("hit", hit)
+  XPL_FUNC_END
+  static xpl_batch_t batch;
+  int count = argc > 1 ? atoi(argv[1]) : 20000;
+  int threads = argc > 2 ? atoi(argv[2]) : 4;
+  char** texts = NULL;
+  xpl_batch_job_t* jobs = NULL;
+  xpl_program_t* progs = NULL;
+  worker_t* workers = NULL;
+  double begin = 0.0;
+  double single = 0.0;
+  double multi = 0.0;
+  int i = 0;
+
+  if(threads < 1 || threads > XPL_BATCH_WORKERS) threads = 4;
+  texts = (char**)calloc(count, sizeof(char*));
+  jobs = (xpl_batch_job_t*)calloc(count, sizeof(xpl_batch_job_t));
+  progs = (xpl_program_t*)calloc(count, sizeof(xpl_program_t));
+  workers = (worker_t*)calloc(threads, sizeof(worker_t));
+  if(!texts || !jobs || !progs || !workers) { printf("Out of memory\n"); return 1; }
+  for(i = 0; i < count; i++) {
+    texts[i] = argc > 3 ? load_text(argv[3 + i % (argc - 3)]) : make_text(i);
+    if(!texts[i]) { printf("Can not read %s\n", argv[3 + i % (argc - 3)]); return 1; }
+    jobs[i].text = texts[i];
+    jobs[i].program = &progs[i];
+  }
+
+  xpl_config_open(&config, funcs, NULL);
+  config.use_hack_pfunc = 0;
+  for(i = 0; i < threads; i++) {
+    xpl_open(&workers[i].context, &config);
+    workers[i].batch = &batch;
+    workers[i].index = i;
+  }
+
+  xpl_batch_open(&batch, jobs, count, 1, 1);
+  xpl_batch_work(&batch, &workers[0].context, 0);
+  xpl_batch_open(&batch, jobs, count, 1, 1);
+  begin = now();
+  xpl_batch_work(&batch, &workers[0].context, 0);
+  single = now() - begin;
+
+  xpl_batch_open(&batch, jobs, count, threads, 1);
+  begin = now();
+  for(i = 0; i < threads; i++)
+    pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+  for(i = 0; i < threads; i++)
+    pthread_join(workers[i].thread, NULL);
+  multi = now() - begin;
+
+  printf("scripts: %d, threads: %d, failed: %ld\n", count, threads, batch.failed);
+  for(i = 0; i < count && i < 8; i++) {
+    if(jobs[i].status != XS_OK)
+      printf("  script %d: status %d at offset %d\n", i, (int)jobs[i].status, jobs[i].error);
+  }
+  printf("1 thread:  %8.2f ms\n", single * 1e3);
+  printf("%d threads: %8.2f ms, %.2fx\n", threads, multi * 1e3, single / multi);
+
+  for(i = 0; i < threads; i++)
+    xpl_close(&workers[i].context);
+  xpl_config_close(&config);
+  for(i = 0; i < count; i++)
+    free(texts[i]);
+  free(workers);
+  free(progs);
+  free(jobs);
+  free(texts);
+
+  return 0;
+}
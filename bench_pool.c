@@ -0,0 +1,229 @@
+/**
+ * Context footprint benchmark, sweeps prepared scripts over a large count
+ * of pooled contexts, once with the compact layout and once with each
+ * context padded to the size of the original single struct context, before
+ * shared settings moved into xpl_config_t. One context in eight runs a
+ * script using registers and loops, only those are handed locals.
+ *
+ * Build and run:
+ *   cc -O2 -o bench_pool bench_pool.c && ./bench_pool [count] [rounds]
+ *
+ * Cache misses are read from perf events on Linux, when permitted.
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://sam.zoy.org/wtfpl/COPYING for more details.
+ */
+
+#define _GNU_SOURCE
+
+#include <stddef.h>
+#include <time.h>
+
+#include "xpl.h"
+
+#ifdef __linux__
+#  include <unistd.h>
+#  include <sys/ioctl.h>
+#  include <sys/syscall.h>
+#  include <linux/perf_event.h>
+#endif /* __linux__ */
+
+typedef struct baseline_t {
+  xpl_func_info_t* funcs;
+  int funcs_count;
+  const char* text;
+  const char* cursor;
+  xpl_bool_composing_t bool_composing;
+  int bool_value;
+  int if_statement_depth;
+  xpl_is_separator_func separator_detect;
+  xpl_is_escape_func escape_detect;
+  xpl_parse_escape_func escape_parse;
+  void* userdata;
+  int use_hack_pfunc;
+  int pfunc_hack;
+} baseline_t;
+
+typedef union padded_t {
+  xpl_context_t context;
+  baseline_t baseline;
+} padded_t;
+
+typedef struct counter_t {
+  int refs;
+  int misses;
+} counter_t;
+
+static long ticks;
+
+static xpl_status_t tick(xpl_context_t* _s) {
+  long v = 0;
+  xpl_get_reg(_s, 0, &v);
+  ticks += v + 1;
+
+  return XS_OK;
+}
+
+static xpl_status_t odd(xpl_context_t* _s) {
+  xpl_push_bool(_s, (int)((size_t)_s->userdata & 1));
+
+  return XS_OK;
+}
+
+static int counter_open(counter_t* _c) {
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
+  _c->refs = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  _c->misses = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  if(_c->refs >= 0 && _c->misses >= 0) return 1;
+  if(_c->refs >= 0) close(_c->refs);
+  if(_c->misses >= 0) close(_c->misses);
+#endif /* __linux__ */
+  _c->refs = _c->misses = -1;
+
+  return 0;
+}
+
+static void counter_start(counter_t* _c) {
+#ifdef __linux__
+  if(_c->refs < 0) return;
+  ioctl(_c->refs, PERF_EVENT_IOC_RESET, 0);
+  ioctl(_c->misses, PERF_EVENT_IOC_RESET, 0);
+  ioctl(_c->refs, PERF_EVENT_IOC_ENABLE, 0);
+  ioctl(_c->misses, PERF_EVENT_IOC_ENABLE, 0);
+#else /* __linux__ */
+  (void)_c;
+#endif /* __linux__ */
+}
+
+static void counter_stop(counter_t* _c, long long* _r, long long* _m) {
+  *_r = *_m = -1;
+#ifdef __linux__
+  if(_c->refs < 0) return;
+  ioctl(_c->refs, PERF_EVENT_IOC_DISABLE, 0);
+  ioctl(_c->misses, PERF_EVENT_IOC_DISABLE, 0);
+  if(read(_c->refs, _r, sizeof(*_r)) != sizeof(*_r)) *_r = -1;
+  if(read(_c->misses, _m, sizeof(*_m)) != sizeof(*_m)) *_m = -1;
+#else /* __linux__ */
+  (void)_c;
+#endif /* __linux__ */
+}
+
+static void sweep(const char* _n, xpl_context_t** _a, int _count, int _rounds, const xpl_program_t* _p, const xpl_program_t* _q, counter_t* _c) {
+  long long refs = 0;
+  long long misses = 0;
+  clock_t begin = 0;
+  double secs = 0.0;
+  int i = 0;
+  int r = 0;
+  for(i = 0; i < _count; i++)
+    xpl_load_program(_a[i], _a[i]->locals ? _q : _p);
+  counter_start(_c);
+  begin = clock();
+  for(r = 0; r < _rounds; r++) {
+    for(i = 0; i < _count; i++) {
+      xpl_reload(_a[i]);
+      xpl_run(_a[i]);
+    }
+  }
+  secs = (double)(clock() - begin) / CLOCKS_PER_SEC;
+  counter_stop(_c, &refs, &misses);
+  printf("%-8s %8.1f ns/context", _n, secs * 1e9 / ((double)_count * _rounds));
+  if(refs > 0 && misses >= 0)
+    printf("  %6.2f misses/context  %5.1f%% miss rate", (double)misses / ((double)_count * _rounds), 100.0 * misses / refs);
+  else
+    printf("  cache counters unavailable");
+  printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("tick", tick)
+    XPL_FUNC_ADD("odd", odd)
+  XPL_FUNC_END
+  static const char text[] = "if odd then tick else tick tick endif tick";
+  static const char cold[] = "store 0 2 tick repeat 2 tick endrepeat";
+  static xpl_program_t prog;
+  static xpl_program_t cold_prog;
+  xpl_config_t config;
+  xpl_context_t probe;
+  xpl_pool_t pool;
+  xpl_context_t* compact = NULL;
+  padded_t* padded = NULL;
+  xpl_context_t** order = NULL;
+  xpl_locals_t* locals = NULL;
+  counter_t counter;
+  int count = argc > 1 ? atoi(argv[1]) : 100000;
+  int rounds = argc > 2 ? atoi(argv[2]) : 10;
+  int i = 0;
+
+  xpl_config_open(&config, funcs, NULL);
+  config.use_hack_pfunc = 0;
+  xpl_open(&probe, &config);
+  xpl_prepare(&probe, &prog, text);
+  xpl_validate(&probe, &prog, NULL);
+  xpl_prepare(&probe, &cold_prog, cold);
+  xpl_validate(&probe, &cold_prog, NULL);
+  xpl_close(&probe);
+  counter_open(&counter);
+
+  printf("contexts: %d, rounds: %d\n", count, rounds);
+  printf("xpl_context_t: %d bytes (%d hot), original context: %d bytes\n",
+    (int)sizeof(xpl_context_t), (int)offsetof(xpl_context_t, userdata), (int)sizeof(baseline_t));
+  printf("xpl_config_t: %d bytes shared once, xpl_locals_t: %d bytes for one context in eight\n",
+    (int)sizeof(xpl_config_t), (int)sizeof(xpl_locals_t));
+  printf("compact: %.1f MiB, padded as original: %.1f MiB, locals: %.1f MiB\n",
+    (double)count * sizeof(xpl_context_t) / (1 << 20), (double)count * sizeof(padded_t) / (1 << 20),
+    (double)(count / 8 + 1) * sizeof(xpl_locals_t) / (1 << 20));
+
+  compact = (xpl_context_t*)calloc(count, sizeof(xpl_context_t));
+  padded = (padded_t*)calloc(count, sizeof(padded_t));
+  order = (xpl_context_t**)calloc(count, sizeof(xpl_context_t*));
+  locals = (xpl_locals_t*)calloc(count / 8 + 1, sizeof(xpl_locals_t));
+  if(!compact || !padded || !order || !locals) { printf("Out of memory\n"); return 1; }
+
+  xpl_pool_open(&pool, &config);
+  xpl_pool_add(&pool, compact, count);
+  for(i = 0; i < count; i++) {
+    xpl_pool_alloc(&pool, &order[i]);
+    order[i]->userdata = (void*)(size_t)i;
+    if(!(i % 8)) order[i]->locals = &locals[i / 8];
+  }
+  sweep("compact", order, count, rounds, &prog, &cold_prog, &counter);
+  for(i = 0; i < count; i++)
+    xpl_pool_free(&pool, order[i]);
+  xpl_pool_close(&pool);
+
+  xpl_pool_open(&pool, &config);
+  for(i = count - 1; i >= 0; i--)
+    xpl_pool_add(&pool, &padded[i].context, 1);
+  for(i = 0; i < count; i++) {
+    xpl_pool_alloc(&pool, &order[i]);
+    order[i]->userdata = (void*)(size_t)i;
+    if(!(i % 8)) order[i]->locals = &locals[i / 8];
+  }
+  sweep("padded", order, count, rounds, &prog, &cold_prog, &counter);
+  for(i = 0; i < count; i++)
+    xpl_pool_free(&pool, order[i]);
+  xpl_pool_close(&pool);
+
+  printf("ticks: %ld\n", ticks);
+  free(locals);
+  free(order);
+  free(padded);
+  free(compact);
+  xpl_config_close(&config);
+
+  return 0;
+}
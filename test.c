@@ -3,6 +3,10 @@
  * Created: Oct. 14, 2011
  * Last edited: Feb. 28, 2012
  *
+ * Build and run, with and without latency histograms:
+ *   cc -std=c99 -pedantic -o test test.c && ./test
+ *   cc -std=c99 -pedantic -DXPL_HISTOGRAM -o test test.c && ./test
+ *
  * This program is free software. It comes without any warranty, to
  * the extent permitted by applicable law. You can redistribute it
  * and/or modify it under the terms of the Do What The Fuck You Want
@@ -16,6 +20,15 @@ static int _xpl_is_rsolidus(unsigned char _c) {
   return _c == '\\';
 }
 
+static int separators;
+
+static int _xpl_count_separator(unsigned char _c) {
+  (void)_c;
+  separators++;
+
+  return 0;
+}
+
 static int _xpl_parse_escape(char** _d, const char** _s) {
   int ret = 0;
   if(*++*_s) {
@@ -52,12 +65,16 @@ static int _xpl_parse_escape(char** _d, const char** _s) {
   return ret;
 }
 
+static char trace[256];
+
 static xpl_status_t test1(xpl_context_t* _s) {
   double f = 0.0;
   printf("test1\n");
+  strcat(trace, "test1 ");
   if(xpl_has_param(_s) == XS_OK) {
     xpl_pop_double(_s, &f);
     printf("has_param %f\n", f);
+    sprintf(trace + strlen(trace), "%g ", f);
   }
 
   return XS_OK;
@@ -65,23 +82,51 @@ static xpl_status_t test1(xpl_context_t* _s) {
 
 static xpl_status_t test2(xpl_context_t* _s) {
   char buf[64] = { '\0' };
+  const char* str = buf;
   printf("test2\n");
+  strcat(trace, "test2 ");
   if(xpl_has_param(_s) == XS_OK) {
-    xpl_pop_string(_s, buf, 64);
-    printf("has_param %s\n", buf);
+    if(_s->locals && _s->locals->arena) xpl_pop_arena_string(_s, &str, NULL);
+    else xpl_pop_string(_s, buf, 64);
+    printf("has_param %s\n", str);
+    strcat(trace, str);
+    strcat(trace, " ");
   }
 
   return XS_OK;
 }
 
+static int params;
+
+static xpl_status_t count(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  while(ret == XS_OK && xpl_has_param(_s) == XS_OK) {
+    ret = xpl_skip_string(_s);
+    params++;
+  }
+
+  return ret;
+}
+
+static xpl_status_t keep(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  const char* str = NULL;
+  while(ret == XS_OK && xpl_has_param(_s) == XS_OK)
+    ret = xpl_pop_arena_string(_s, &str, NULL);
+
+  return ret;
+}
+
 static xpl_status_t test3(xpl_context_t* _s) {
   printf("test3\n");
+  strcat(trace, "test3 ");
 
   return XS_OK;
 }
 
 static xpl_status_t cond1(xpl_context_t* _s) {
   printf("cond1\n");
+  strcat(trace, "cond1 ");
   xpl_push_bool(_s, 0);
 
   return XS_OK;
@@ -89,31 +134,428 @@ static xpl_status_t cond1(xpl_context_t* _s) {
 
 static xpl_status_t cond2(xpl_context_t* _s) {
   printf("cond2\n");
+  strcat(trace, "cond2 ");
+  xpl_push_bool(_s, 1);
+
+  return XS_OK;
+}
+
+static int relays;
+
+static xpl_status_t has_relay(xpl_context_t* _s) {
+  printf("has_relay\n");
+  relays++;
   xpl_push_bool(_s, 1);
 
   return XS_OK;
 }
 
+static xpl_status_t no_relay(xpl_context_t* _s) {
+  printf("no_relay\n");
+  relays++;
+  xpl_push_bool(_s, 0);
+
+  return XS_OK;
+}
+
+static xpl_config_t config;
+
 static xpl_context_t xpl;
 
+static xpl_context_t copy;
+
+static xpl_locals_t locals;
+
+static xpl_locals_t copy_locals;
+
+static xpl_registry_t registry;
+
+static xpl_program_t prog;
+
+#ifdef XPL_HISTOGRAM
+static xpl_hist_t hist;
+
+static xpl_hist_t script_hist;
+
+static xpl_hist_t taken;
+#endif /* XPL_HISTOGRAM */
+
+static char strings[256];
+
+static long long region[(sizeof(xpl_store_t) + sizeof(xpl_program_t)) / sizeof(long long) + 64];
+
 int main() {
   XPL_FUNC_BEGIN(funcs)
     XPL_FUNC_ADD("test3", test3)
     XPL_FUNC_ADD("test2", test2)
     XPL_FUNC_ADD("test1", test1)
+    XPL_FUNC_ADD("keep", keep)
+    XPL_FUNC_ADD("count", count)
     XPL_FUNC_ADD("cond2", cond2)
     XPL_FUNC_ADD("cond1", cond1)
+    XPL_FUNC_ADD_CONST("has_relay", has_relay)
+    XPL_FUNC_ADD_CONST("no_relay", no_relay)
   XPL_FUNC_END
 
-  xpl_open(&xpl, funcs, NULL);
-    xpl.escape_detect = _xpl_is_rsolidus;
-    xpl.escape_parse = _xpl_parse_escape;
-    xpl_load(&xpl, "if cond1 then test1 3.14 elseif cond2 then test2 \"hello world\" else test3 endif");
-    xpl_run(&xpl);
-    xpl_load(&xpl, "if cond1 then if cond2 3 then test3 elseif cond2 then test3 endif test3 endif test2 \"hello world\"");
-    xpl_run(&xpl);
+  xpl_config_open(&config, funcs, NULL);
+  config.escape_detect = _xpl_is_rsolidus;
+  config.escape_parse = _xpl_parse_escape;
+#ifdef XPL_HISTOGRAM
+  xpl_hist_open(&hist);
+  config.hist = &hist;
+#endif /* XPL_HISTOGRAM */
+  xpl_open(&xpl, &config);
+  xpl.locals = &locals;
+    {
+      xpl_status_t st = XS_OK;
+      trace[0] = '\0';
+      xpl_load(&xpl, "if cond1 then test1 3.14 elseif cond2 then test2 \"hello world\" else test3 endif");
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "cond1 cond2 test2 hello world "));
+      trace[0] = '\0';
+      xpl_load(&xpl, "if cond1 then if cond2 3 then test3 elseif cond2 then test3 endif test3 endif test2 \"hello world\"");
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "cond1 test2 hello world "));
+      trace[0] = '\0';
+      xpl_load(&xpl, "cond2 store 0 store 1 42 if load 0 and load 1 then test1 2.72 endif");
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "cond2 test1 2.72 "));
+      assert(locals.regs[0] == 1 && locals.regs[1] == 42);
+      trace[0] = '\0';
+      st = xpl_prepare(&xpl, &prog, "store 0 2 switch 0 case 1 test1 1 case 2 test2 \"two\" default test3 endswitch test1 4");
+      assert(st == XS_OK);
+      xpl_load_program(&xpl, &prog);
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "test2 two test1 4 "));
+      (void)st;
+    }
+    {
+      /* A register index beyond int never wraps into a valid slot. */
+      xpl_status_t st = XS_OK;
+      xpl_load(&xpl, "store 4294967296 5");
+      st = xpl_run(&xpl); assert(st == XS_BAD_REGISTER_INDEX);
+      xpl_load(&xpl, "load -4294967296");
+      st = xpl_run(&xpl); assert(st == XS_BAD_REGISTER_INDEX);
+      (void)st;
+    }
+    {
+      /* Registers and loops live in locals, a context without them fails. */
+      unsigned char snapshot[XPL_SNAPSHOT_SIZE];
+      long v = 0;
+      int size = 0;
+      xpl_status_t st = XS_OK;
+      xpl_prepare(&xpl, &prog, "store 3 7 repeat 2 test3 yield endrepeat");
+      xpl_load_program(&xpl, &prog);
+      st = xpl_run(&xpl); assert(st == XS_SUSPENT);
+      st = xpl_get_reg(&xpl, 3, &v); assert(st == XS_OK && v == 7);
+      st = xpl_snapshot(&xpl, snapshot, sizeof(snapshot), &size); assert(st == XS_OK);
+      copy.locals = NULL;
+      st = xpl_clone(&copy, &xpl); assert(st == XS_NO_LOCALS);
+      copy.locals = &copy_locals;
+      st = xpl_clone(&copy, &xpl); assert(st == XS_OK && copy.locals == &copy_locals);
+      assert(copy_locals.regs[3] == 7 && copy_locals.loop_counters[0] == 2);
+      xpl.locals = NULL;
+      st = xpl_get_reg(&xpl, 3, &v); assert(st == XS_NO_LOCALS);
+      xpl_reload(&xpl);
+      st = xpl_restore(&xpl, snapshot, size); assert(st == XS_NO_LOCALS);
+      st = xpl_run(&xpl); assert(st == XS_NO_LOCALS);
+      xpl_load(&xpl, "test3");
+      st = xpl_run(&xpl); assert(st == XS_OK);
+      xpl.locals = &locals;
+      xpl_reload(&xpl);
+      assert(locals.regs[3] == 0);
+      (void)st;
+    }
+    {
+      /* Labels are hashed by owner and value, and rehashed after an edit. */
+      static const long values[] = { -5, 3, 1000000, 7 };
+      static const long arms[] = { 1, 2, 3, 4 };
+      char text[160] = "switch 0 case -5 store 1 1 case 3 store 1 2 case 1000000 store 1 3 default store 1 4 endswitch "
+        "switch 2 case 3 store 3 9 endswitch";
+      xpl_status_t st = XS_OK;
+      int i = 0;
+      st = xpl_prepare(&xpl, &prog, text); assert(st == XS_OK && prog.cases_count == 4);
+      for(i = 0; i < 4; i++) {
+        xpl_load_program(&xpl, &prog);
+        xpl_set_reg(&xpl, 0, values[i]);
+        xpl_set_reg(&xpl, 2, values[i]);
+        st = xpl_run(&xpl); assert(st == XS_OK);
+        assert(locals.regs[1] == arms[i] && locals.regs[3] == (values[i] == 3 ? 9 : 0));
+      }
+      st = xpl_edit(&xpl, &prog, text, sizeof(text), (int)(strstr(text, "case 3") - text) + 5, 1, "4"); assert(st == XS_OK);
+      xpl_load_program(&xpl, &prog);
+      xpl_set_reg(&xpl, 0, 4);
+      st = xpl_run(&xpl); assert(st == XS_OK && locals.regs[1] == 2);
+      xpl_load_program(&xpl, &prog);
+      xpl_set_reg(&xpl, 0, 3);
+      st = xpl_run(&xpl); assert(st == XS_OK && locals.regs[1] == 4);
+      (void)st;
+    }
+    {
+      /* A taken arm runs on the main loop, nested arms and their
+         parameters are skipped as a whole, and 'yield' works inside. */
+      xpl_status_t st = XS_OK;
+      xpl_load(&xpl, "if cond2 then if cond2 then store 0 1 elseif cond2 then store 0 2 else store 0 3 endif store 1 4 "
+        "elseif cond2 then store 0 5 else store 0 6 endif store 2 7");
+      st = xpl_run(&xpl); assert(st == XS_OK && locals.regs[0] == 1 && locals.regs[1] == 4 && locals.regs[2] == 7);
+      xpl_load(&xpl, "if cond1 then store 0 9 elseif cond2 then store 0 8 else store 0 7 endif");
+      st = xpl_run(&xpl); assert(st == XS_OK && locals.regs[0] == 8);
+      xpl_load(&xpl, "if cond2 then store 0 1 yield store 1 2 else store 1 9 endif store 2 3");
+      st = xpl_run(&xpl); assert(st == XS_SUSPENT && locals.regs[0] == 1 && !locals.regs[1]);
+      st = xpl_run(&xpl); assert(st == XS_OK && locals.regs[1] == 2 && locals.regs[2] == 3);
+      /* A comma ends the parameters of a statement, it's not one itself. */
+      params = 0;
+      xpl_load(&xpl, "count 1, count 2 3,count ");
+      st = xpl_run(&xpl); assert(st == XS_OK && params == 3);
+      (void)st;
+    }
+    {
+      /* Running out of steps and yielding are told apart, both resume. */
+      xpl_status_t st = XS_OK;
+      xpl_load(&xpl, "store 0 1 store 1 2 store 2 3");
+      st = xpl_run_steps(&xpl, 2); assert(st == XS_BUDGET && locals.regs[1] == 2 && !locals.regs[2]);
+      st = xpl_run_steps(&xpl, 0); assert(st == XS_BUDGET);
+      st = xpl_run_steps(&xpl, 2); assert(st == XS_OK && locals.regs[2] == 3);
+      xpl_load(&xpl, "store 0 1 yield store 1 2");
+      st = xpl_run_steps(&xpl, 10); assert(st == XS_SUSPENT && locals.regs[0] == 1 && !locals.regs[1]);
+      st = xpl_run_steps(&xpl, 10); assert(st == XS_OK && locals.regs[1] == 2);
+      (void)st;
+    }
+    {
+      /* A misspelt interface is never taken as a parameter. */
+      xpl_status_t st = XS_OK;
+      int pos = 0;
+      xpl_prepare(&xpl, &prog, "test1 1 tset3");
+      st = xpl_validate(&xpl, &prog, &pos); assert(st == XS_SYNTAX_ERROR && pos == 8);
+      (void)st;
+    }
+    {
+      xpl_status_t st = XS_OK;
+      trace[0] = '\0';
+      st = xpl_prepare(&xpl, &prog, "repeat 2 test3 endrepeat while cond1 do test3 endwhile"); assert(st == XS_OK);
+      st = xpl_validate(&xpl, &prog, NULL); assert(st == XS_OK);
+      xpl_load_program(&xpl, &prog);
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "test3 test3 cond1 "));
+      trace[0] = '\0';
+      st = xpl_prepare(&xpl, &prog, "if has_relay then test1 1 else test3 endif"); assert(st == XS_OK);
+      xpl_load_program(&xpl, &prog);
+      st = xpl_run(&xpl); assert(st == XS_OK);
+      xpl_reload(&xpl);
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "test1 1 test1 1 "));
+      (void)st;
+    }
+    {
+      /* Constant interfaces are folded away, none is called at runtime. */
+      xpl_status_t st = XS_OK;
+      st = xpl_prepare(&xpl, &prog, "if cond1 then test1 1 elseif has_relay then test3 endif "
+        "if no_relay then test1 2 elseif cond1 then test1 3 elseif has_relay then test2 \"folded\" endif");
+      assert(st == XS_OK);
+      xpl_load_program(&xpl, &prog);
+      relays = 0;
+      st = xpl_run(&xpl); assert(st == XS_OK);
+      assert(relays == 0);
+      (void)st;
+    }
+    xpl_registry_open(&registry, &config);
+    config.registry = &registry;
+    {
+      xpl_func_info_t plugin = { "plugin", test3, 0 };
+      xpl_func_info_t shadow = { "test1", test3, 0 };
+      xpl_status_t st = XS_OK;
+      st = xpl_register(&registry, &shadow); assert(st == XS_NAME_EXISTS);
+      st = xpl_register(&registry, &plugin); assert(st == XS_OK);
+      trace[0] = '\0';
+      xpl_load(&xpl, "plugin test2 \"from plugin\"");
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "test3 test2 from plugin "));
+      st = xpl_unregister(&registry, "plugin"); assert(st == XS_OK);
+      xpl_load(&xpl, "plugin");
+      st = xpl_run(&xpl); assert(st != XS_OK);
+      (void)st;
+    }
+    {
+      /* Unregistered slots and nodes are recycled, loading and unloading
+         plugins never fills the registry up. */
+      xpl_func_info_t plugin = { NULL, has_relay, 0 };
+      xpl_func_info_t* held = NULL;
+      xpl_status_t st = XS_OK;
+      char name[16];
+      int parity = 0;
+      int i = 0;
+      for(i = 0; i < XPL_REGISTRY_COUNT * 4; i++) {
+        sprintf(name, "plugin%d", i);
+        plugin.name = name;
+        st = xpl_register(&registry, &plugin); assert(st == XS_OK);
+        xpl_load(&xpl, name);
+        relays = 0;
+        st = xpl_run(&xpl); assert(st == XS_OK && relays == 1);
+        st = xpl_unregister(&registry, name); assert(st == XS_OK);
+      }
+      assert(registry.funcs_count == 1 && registry.nodes_count <= 16);
+      /* Nothing unlinked is reused while a lookup could still hold it. */
+      plugin.name = "held";
+      st = xpl_register(&registry, &plugin); assert(st == XS_OK);
+      xpl_registry_enter(&registry, &parity);
+      held = xpl_find_func(&xpl, "held");
+      st = xpl_unregister(&registry, "held"); assert(st == XS_OK);
+      plugin.name = "other";
+      plugin.func = test3;
+      st = xpl_register(&registry, &plugin); assert(st == XS_OK);
+      assert(held && held->func == has_relay && !strcmp(held->name, "held"));
+      xpl_registry_leave(&registry, parity);
+      st = xpl_unregister(&registry, "other"); assert(st == XS_OK);
+      assert(!xpl_find_func(&xpl, "held") && !xpl_find_func(&xpl, "other"));
+      (void)st;
+    }
+    {
+      /* A snapshot or a clone resumes right after 'yield'. */
+      unsigned char snapshot[XPL_SNAPSHOT_SIZE];
+      int size = 0;
+      xpl_status_t st = XS_OK;
+      trace[0] = '\0';
+      xpl_load(&xpl, "test1 1 yield test2 \"resumed\"");
+      st = xpl_run(&xpl); assert(st == XS_SUSPENT && !strcmp(trace, "test1 1 "));
+      st = xpl_snapshot(&xpl, snapshot, sizeof(snapshot), &size); assert(st == XS_OK && size > 8);
+      st = xpl_clone(&copy, &xpl); assert(st == XS_OK);
+      st = xpl_run(&copy); assert(st == XS_OK && !strcmp(trace, "test1 1 test2 resumed "));
+      trace[0] = '\0';
+      xpl_reload(&xpl);
+      st = xpl_restore(&xpl, snapshot, size); assert(st == XS_OK);
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "test2 resumed "));
+      snapshot[8] ^= 0x7f;
+      xpl_reload(&xpl);
+      st = xpl_restore(&xpl, snapshot, size); assert(st != XS_OK);
+      xpl_load(&xpl, "test3");
+      snapshot[8] ^= 0x7f;
+      st = xpl_restore(&xpl, snapshot, size); assert(st == XS_SNAPSHOT_MISMATCH);
+      (void)st;
+    }
+    {
+      /* An edit inside a block reshapes it in place. */
+      char text[128] = "if cond1 then test1 1 endif test2 \"edit\" repeat 2 test3 endrepeat";
+      xpl_status_t st = XS_OK;
+      st = xpl_prepare(&xpl, &prog, text); assert(st == XS_OK);
+      st = xpl_validate(&xpl, &prog, NULL); assert(st == XS_OK);
+      st = xpl_edit(&xpl, &prog, text, sizeof(text), 20, 1, "2 else test3"); assert(st == XS_OK);
+      assert(!strcmp(text, "if cond1 then test1 2 else test3 endif test2 \"edit\" repeat 2 test3 endrepeat"));
+      assert(prog.validated);
+      trace[0] = '\0';
+      xpl_load_program(&xpl, &prog);
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "cond1 test3 test2 edit test3 test3 "));
+      st = xpl_edit(&xpl, &prog, text, sizeof(text), 0, 0, "endif "); assert(st == XS_SYNTAX_ERROR);
+      (void)st;
+    }
+    {
+      /* Outside of blocks an edit scans only the statements around it. */
+      static char flat[1024];
+      xpl_status_t st = XS_OK;
+      int full = 0;
+      int i = 0;
+      for(i = 0; i < 100; i++) strcat(flat, "store 1 1 ");
+      config.separator_detect = _xpl_count_separator;
+      separators = 0;
+      st = xpl_prepare(&xpl, &prog, flat); assert(st == XS_OK);
+      st = xpl_validate(&xpl, &prog, NULL); assert(st == XS_OK);
+      full = separators;
+      separators = 0;
+      st = xpl_edit(&xpl, &prog, flat, sizeof(flat), 50 * 10 + 6, 1, "2"); assert(st == XS_OK);
+      assert(separators * 20 < full);
+      config.separator_detect = NULL;
+      assert(prog.validated && prog.stmts_count == 100 && prog.stmts[50].pos == 500 && prog.stmts[50].end == 509);
+      xpl_load_program(&xpl, &prog);
+      st = xpl_run(&xpl); assert(st == XS_OK && locals.regs[1] == 1 && locals.regs[2] == 1);
+      st = xpl_edit(&xpl, &prog, flat, sizeof(flat), 50 * 10, 10, ""); assert(st == XS_OK);
+      assert(prog.stmts_count == 99 && prog.stmts[50].pos == 500);
+      xpl_load_program(&xpl, &prog);
+      st = xpl_run(&xpl); assert(st == XS_OK && locals.regs[1] == 1 && locals.regs[2] == 0);
+      (void)st;
+      (void)full;
+    }
+    {
+      static const char rule[] = "if cond2 then test2 \"stored\" else test3 endif repeat 2 test1 5 endrepeat";
+      xpl_store_t* store = NULL;
+      const xpl_store_t* shared = NULL;
+      const xpl_program_t* loaded = NULL;
+      xpl_status_t st = XS_OK;
+      st = xpl_prepare(&xpl, &prog, rule); assert(st == XS_OK);
+      st = xpl_validate(&xpl, &prog, NULL); assert(st == XS_OK);
+      st = xpl_store_open(region, sizeof(region), &config, &store); assert(st == XS_OK);
+      st = xpl_store_put(store, "rule", &prog); assert(st == XS_OK);
+      st = xpl_store_attach(region, sizeof(region), &config, &shared); assert(st == XS_OK);
+      st = xpl_store_load(&copy, shared, "rule"); assert(st == XS_OK);
+      loaded = copy.program;
+      assert(loaded && loaded != &prog && copy.text != rule && !strcmp(copy.text, rule));
+      assert(loaded->jumps_count == prog.jumps_count && !memcmp(loaded->jumps, prog.jumps, prog.jumps_count * sizeof(xpl_jump_t)));
+      assert(loaded->cases_count == prog.cases_count && !memcmp(loaded->cases, prog.cases, prog.cases_count * sizeof(xpl_case_t)));
+      assert(loaded->spans_count == prog.spans_count && !memcmp(loaded->spans, prog.spans, prog.spans_count * sizeof(xpl_span_t)));
+      assert(loaded->validated == prog.validated && loaded->stmts_count == prog.stmts_count &&
+        !memcmp(loaded->stmts, prog.stmts, prog.stmts_count * sizeof(xpl_stmt_t)));
+      trace[0] = '\0';
+      st = xpl_run(&copy); assert(st == XS_OK && !strcmp(trace, "cond2 test2 stored test1 5 test1 5 "));
+      st = xpl_store_load(&copy, shared, "missing"); assert(st == XS_NAME_NOT_FOUND);
+      /* A lookup never spins forever on a publishing left halfway. */
+      store->generation = store->generation + 1;
+      st = xpl_store_load(&copy, shared, "rule"); assert(st == XS_STORE_BUSY);
+      store->generation = store->generation + 1;
+      st = xpl_store_load(&copy, shared, "rule"); assert(st == XS_OK);
+      (void)st;
+    }
+    {
+      xpl_arena_t arena;
+      xpl_status_t st = XS_OK;
+      xpl_arena_open(&arena, strings, sizeof(strings));
+      locals.arena = &arena;
+      trace[0] = '\0';
+      xpl_load(&xpl, "test2 \"from arena\" test2 \"tab\\tescaped\"");
+      st = xpl_run(&xpl); assert(st == XS_OK && !strcmp(trace, "test2 from arena test2 tab\tescaped "));
+      assert(arena.used == 0 && arena.peak > 0);
+      {
+        /* Sliced runs free their strings once finished as well. */
+        int i = 0;
+        xpl_load(&xpl, "keep \"sliced run one\" keep \"sliced run two\" \"three\"");
+        for(i = 0; i < 100 && st == XS_OK; i++) {
+          xpl_reload(&xpl);
+          do st = xpl_run_steps(&xpl, 1); while(st == XS_BUDGET);
+          assert(st == XS_OK && arena.used == 0);
+        }
+      }
+      locals.arena = NULL;
+      (void)st;
+    }
+#ifdef XPL_HISTOGRAM
+    {
+      /* A context histogram is kept across loads and reset by taking it. */
+      long long n = 0;
+      xpl_status_t st = XS_OK;
+      int i = 0;
+      xpl_hist_open(&script_hist);
+      xpl.hist = &script_hist;
+      xpl_load(&xpl, "test3");
+      st = xpl_run(&xpl); assert(st == XS_OK);
+      xpl_reload(&xpl);
+      st = xpl_run(&xpl); assert(st == XS_OK);
+      xpl_load(&xpl, "test3 yield test3");
+      st = xpl_run(&xpl); assert(st == XS_SUSPENT);
+      xpl_load(&xpl, "load 99");
+      st = xpl_run(&xpl); assert(st == XS_BAD_REGISTER_INDEX);
+      xpl_load(&xpl, "test3 test3");
+      st = xpl_run_steps(&xpl, 1); assert(st == XS_BUDGET);
+      assert(script_hist.count == 4);
+      st = xpl_run_steps(&xpl, 1); assert(st == XS_OK);
+      assert(xpl.hist == &script_hist);
+      assert(script_hist.count == 5 && script_hist.yields == 1 && script_hist.errors == 1);
+      st = xpl_hist_take(&script_hist, &taken); assert(st == XS_OK);
+      for(i = 0; i < XPL_HIST_BUCKETS; i++) {
+        assert(!script_hist.counts[i]);
+        n += taken.counts[i];
+      }
+      assert(taken.count == 5 && n == 5 && taken.yields == 1 && taken.errors == 1 && taken.sum >= 0);
+      assert(!script_hist.count && !script_hist.sum && !script_hist.yields && !script_hist.errors);
+      assert(xpl_hist_quantile(&taken, 1.0) >= xpl_hist_quantile(&taken, 0.5));
+      assert(hist.count >= taken.count);
+      xpl.hist = NULL;
+      (void)st;
+    }
+    xpl_hist_print(&hist, "test", stdout, 0);
+#endif /* XPL_HISTOGRAM */
     xpl_unload(&xpl);
   xpl_close(&xpl);
+  xpl_config_close(&config);
 
   return 0;
 }
@@ -0,0 +1,74 @@
+/**
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://sam.zoy.org/wtfpl/COPYING for more details.
+ */
+
+#include "xpl.hpp"
+
+static xpl_status_t test1(xpl_context_t* _s) {
+  long l = 0;
+  printf("test1\n");
+  if(xpl_has_param(_s) == XS_OK) {
+    xpl_pop_long(_s, &l);
+    printf("has_param %ld\n", l);
+  }
+
+  return XS_OK;
+}
+
+static xpl_status_t test2(xpl_context_t* _s) {
+  char buf[64] = { '\0' };
+  printf("test2\n");
+  if(xpl_has_param(_s) == XS_OK) {
+    xpl_pop_string(_s, buf, 64);
+    printf("has_param %s\n", buf);
+  }
+
+  return XS_OK;
+}
+
+static xpl_status_t cond1(xpl_context_t* _s) {
+  printf("cond1\n");
+  xpl_push_bool(_s, 0);
+
+  return XS_OK;
+}
+
+static constexpr xpl_func_info_t my_funcs[] = {
+  { "test1", test1, 0 },
+  { "test2", test2, 0 },
+  { "cond1", cond1, 0 }
+};
+
+static constexpr auto funcs = xpl::make_funcs(my_funcs);
+
+static constexpr char text[] =
+  "store 0 2 "
+  "switch 0 case 1 test1 1 case 2 test2 \"two\" default test1 0 endswitch "
+  "repeat 2 test1 3 endrepeat "
+  "while cond1 do test1 4 endwhile";
+
+static constexpr xpl_program_t prog = xpl::compile(text, funcs);
+
+static_assert(prog.jumps_count == 8, "Jumps resolved while compiling");
+static_assert(prog.cases_count == 2, "Labels resolved while compiling");
+static_assert(prog.validated && prog.stmts_count == 17, "Statements resolved while compiling");
+
+static xpl_config_t cfg;
+
+static xpl_context_t ctx;
+
+int main() {
+  xpl::config_open(&cfg, funcs);
+  xpl_open(&ctx, &cfg);
+    xpl_load_program(&ctx, &prog);
+    xpl_run(&ctx);
+    xpl_unload(&ctx);
+  xpl_close(&ctx);
+  xpl_config_close(&cfg);
+
+  return 0;
+}
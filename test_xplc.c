@@ -0,0 +1,150 @@
+/**
+ * Differential test, runs each script under test_xplc/ with both the
+ * interpreter and the code translated by xplc, then compares their traces.
+ *
+ * Build and run:
+ *   cc -o xplc xplc.c
+ *   ./xplc -f rec -f one -f t -f f -f cnt -p aot_ -t aot_scripts -o test_xplc.h test_xplc/\*.xpl
+ *   cc -o xplc_test test_xplc.c && ./xplc_test
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://sam.zoy.org/wtfpl/COPYING for more details.
+ */
+
+#include "xpl.h"
+
+static char trace[4096];
+
+static int counter;
+
+static void append(const char* _s) {
+  strncat(trace, _s, sizeof(trace) - strlen(trace) - 1);
+}
+
+static xpl_status_t rec(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  char buf[64] = { '\0' };
+  append("rec(");
+  while(xpl_has_param(_s) == XS_OK) {
+    if((ret = xpl_pop_string(_s, buf, sizeof(buf))) != XS_OK) return ret;
+    append(buf);
+    append(";");
+  }
+  append(") ");
+
+  return XS_OK;
+}
+
+static xpl_status_t one(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  long l = 0;
+  char buf[32] = { '\0' };
+  if((ret = xpl_pop_long(_s, &l)) != XS_OK) return ret;
+  sprintf(buf, "one(%ld) ", l);
+  append(buf);
+
+  return XS_OK;
+}
+
+static xpl_status_t t(xpl_context_t* _s) {
+  append("t ");
+
+  return xpl_push_bool(_s, 1);
+}
+
+static xpl_status_t f(xpl_context_t* _s) {
+  append("f ");
+
+  return xpl_push_bool(_s, 0);
+}
+
+static xpl_status_t cnt(xpl_context_t* _s) {
+  append("cnt ");
+
+  return xpl_push_bool(_s, counter++ < 5);
+}
+
+#include "test_xplc.h"
+
+static char* load_text(const char* _n) {
+  const char* n = _n + strlen("aot_");
+  char path[256] = { '\0' };
+  FILE* fp = NULL;
+  char* ret = NULL;
+  long l = 0;
+  sprintf(path, "test_xplc/%s.xpl", n);
+  if(!(fp = fopen(path, "rb"))) return NULL;
+  fseek(fp, 0, SEEK_END);
+  l = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  ret = (char*)malloc(l + 1);
+  l = (long)fread(ret, 1, l, fp);
+  ret[l] = '\0';
+  fclose(fp);
+
+  return ret;
+}
+
+static xpl_config_t config;
+
+static xpl_context_t xpl;
+
+static xpl_locals_t locals;
+
+static xpl_program_t prog;
+
+int main() {
+  XPL_FUNC_BEGIN(funcs)
+    XPL_FUNC_ADD("rec", rec)
+    XPL_FUNC_ADD("one", one)
+    XPL_FUNC_ADD("t", t)
+    XPL_FUNC_ADD("f", f)
+    XPL_FUNC_ADD("cnt", cnt)
+  XPL_FUNC_END
+  char expected[sizeof(trace) + 16] = { '\0' };
+  long regs[XPL_REG_COUNT];
+  xpl_status_t st = XS_OK;
+  char* text = NULL;
+  int failed = 0;
+  int i = 0;
+
+  xpl_config_open(&config, funcs, NULL);
+  config.use_hack_pfunc = 0;
+  xpl_open(&xpl, &config);
+  xpl.locals = &locals;
+  for(i = 0; aot_scripts[i].name; i++) {
+    if(!(text = load_text(aot_scripts[i].name))) {
+      printf("FAIL %s: can not read script\n", aot_scripts[i].name);
+      failed++;
+      continue;
+    }
+    trace[0] = '\0'; counter = 0;
+    if((st = xpl_prepare(&xpl, &prog, text)) == XS_OK) {
+      xpl_load_program(&xpl, &prog);
+      st = xpl_run(&xpl);
+    }
+    sprintf(expected, "%s=> %d", trace, (int)st);
+    memcpy(regs, locals.regs, sizeof(regs));
+
+    xpl_unload(&xpl);
+    memset(locals.regs, 0, sizeof(locals.regs));
+    trace[0] = '\0'; counter = 0;
+    st = aot_scripts[i].func(&xpl);
+    sprintf(trace + strlen(trace), "=> %d", (int)st);
+
+    if(strcmp(expected, trace) || memcmp(regs, locals.regs, sizeof(regs))) {
+      printf("FAIL %s:\n  interpreted: %s\n  translated:  %s\n", aot_scripts[i].name, expected, trace);
+      failed++;
+    } else {
+      printf("ok %s: %s\n", aot_scripts[i].name, trace);
+    }
+    free(text);
+  }
+  xpl_close(&xpl);
+  xpl_config_close(&config);
+
+  return failed ? 1 : 0;
+}
@@ -20,6 +20,11 @@
 #  pragma warning(disable : 4706)
 #endif /* _MSC_VER */
 
+#if defined XPL_HISTOGRAM && defined __STRICT_ANSI__ && !defined _WIN32 && \
+  !defined _POSIX_C_SOURCE && !defined _XOPEN_SOURCE && !defined _GNU_SOURCE
+#  define _POSIX_C_SOURCE 199309L /* For clock_gettime under -std=c99 and alike. */
+#endif /* XPL_HISTOGRAM && __STRICT_ANSI__ && !_WIN32 && ... */
+
 #include <memory.h>
 #include <assert.h>
 #include <string.h>
@@ -62,6 +67,152 @@ extern "C" {
 #  define xpl_assert(e) assert(e)
 #endif /* !xpl_assert */
 
+/**
+ * @brief Store barrier, orders filling a registry entry before publishing it.
+ */
+#ifndef xpl_barrier
+#  if defined __GNUC__ || defined __clang__
+#    define xpl_barrier() __sync_synchronize()
+#  else /* __GNUC__ || __clang__ */
+#    define xpl_barrier() ((void)0)
+#  endif /* __GNUC__ || __clang__ */
+#endif /* !xpl_barrier */
+
+/**
+ * @brief Atomic increment, returns the value before incrementing, used to
+ *  claim batch jobs from several threads.
+ */
+#ifndef xpl_atomic_inc
+#  if defined __GNUC__ || defined __clang__
+#    define xpl_atomic_inc(p) __sync_fetch_and_add((p), 1)
+#  elif defined _MSC_VER
+#    include <intrin.h>
+#    define xpl_atomic_inc(p) (_InterlockedIncrement((volatile long*)(p)) - 1)
+#  else /* __GNUC__ || __clang__ */
+#    define xpl_atomic_inc(p) ((*(p))++)
+#  endif /* __GNUC__ || __clang__ */
+#endif /* !xpl_atomic_inc */
+/**
+ * @brief Atomic addition on a 64-bit counter, returns the value before
+ *  adding.
+ */
+#ifndef xpl_atomic_add
+#  if defined __GNUC__ || defined __clang__
+#    define xpl_atomic_add(p, v) __sync_fetch_and_add((p), (v))
+#  elif defined _MSC_VER
+#    define xpl_atomic_add(p, v) _InterlockedExchangeAdd64((volatile long long*)(p), (v))
+#  else /* __GNUC__ || __clang__ */
+#    define xpl_atomic_add(p, v) (((*(p)) += (v)) - (v))
+#  endif /* __GNUC__ || __clang__ */
+#endif /* !xpl_atomic_add */
+/**
+ * @brief Atomic exchange on a 64-bit counter, returns the value before
+ *  storing.
+ */
+#ifndef xpl_atomic_xchg
+#  if defined __GNUC__ || defined __clang__
+#    define xpl_atomic_xchg(p, v) __sync_lock_test_and_set((p), (v))
+#  elif defined _MSC_VER
+#    define xpl_atomic_xchg(p, v) _InterlockedExchange64((volatile long long*)(p), (v))
+#  else /* __GNUC__ || __clang__ */
+XPLINTERNAL long long _xpl_xchg(volatile long long* _p, long long _v) { long long ret = *_p; *_p = _v; return ret; }
+#    define xpl_atomic_xchg(p, v) _xpl_xchg((p), (v))
+#  endif /* __GNUC__ || __clang__ */
+#endif /* !xpl_atomic_xchg */
+
+/**
+ * @brief Count of register slots preallocated in each context.
+ */
+#ifndef XPL_REG_COUNT
+#  define XPL_REG_COUNT 8
+#endif /* !XPL_REG_COUNT */
+
+/**
+ * @brief Capacities of a runtime interface registry.
+ */
+#ifndef XPL_REGISTRY_COUNT
+#  define XPL_REGISTRY_COUNT 64  /**< Max count of registered interfaces. */
+#endif /* !XPL_REGISTRY_COUNT */
+#ifndef XPL_REGISTRY_NODES
+#  define XPL_REGISTRY_NODES 512 /**< Max count of name index nodes. */
+#endif /* !XPL_REGISTRY_NODES */
+
+/**
+ * @brief Capacities of a prepared program.
+ */
+#ifndef XPL_JUMP_COUNT
+#  define XPL_JUMP_COUNT 64  /**< Max count of resolved jumps. */
+#endif /* !XPL_JUMP_COUNT */
+#ifndef XPL_CASE_COUNT
+#  define XPL_CASE_COUNT 64  /**< Max count of 'case' labels. */
+#endif /* !XPL_CASE_COUNT */
+#define XPL_CASE_SLOTS (XPL_CASE_COUNT * 2) /**< Slots of the 'case' label hash table, at most half used. */
+#define XPL_CASE_HASH(p, l) \
+  ((int)((((unsigned long)(p) * 0x9e3779b1UL) ^ ((unsigned long)(l) * 0x85ebca6bUL)) % XPL_CASE_SLOTS)) /**< Home slot of a 'case' label by owner and value. */
+#ifndef XPL_SPAN_COUNT
+#  define XPL_SPAN_COUNT 64  /**< Max count of top level blocks. */
+#endif /* !XPL_SPAN_COUNT */
+#ifndef XPL_STMT_COUNT
+#  define XPL_STMT_COUNT 1024 /**< Max count of statements of a validated program. */
+#endif /* !XPL_STMT_COUNT */
+#ifndef XPL_STORE_COUNT
+#  define XPL_STORE_COUNT 4096 /**< Max count of programs in a shared store. */
+#endif /* !XPL_STORE_COUNT */
+#ifndef XPL_STORE_RETRIES
+#  define XPL_STORE_RETRIES 4096 /**< Max count of lookups overlapping a publishing. */
+#endif /* !XPL_STORE_RETRIES */
+#ifndef XPL_BATCH_WORKERS
+#  define XPL_BATCH_WORKERS 64 /**< Max count of threads working on a batch. */
+#endif /* !XPL_BATCH_WORKERS */
+#ifdef XPL_HISTOGRAM
+#  include <time.h>
+#  ifndef XPL_HIST_SUB_BITS
+#    define XPL_HIST_SUB_BITS 3 /**< Sub-buckets of each power of 2 in bits, 12.5% precision. */
+#  endif /* !XPL_HIST_SUB_BITS */
+#  define XPL_HIST_BUCKETS (((int)sizeof(long long) * 8 - XPL_HIST_SUB_BITS) << XPL_HIST_SUB_BITS) /**< Count of latency buckets. */
+#  ifndef XPL_HIST_CLOCK
+#    if !defined CLOCK_MONOTONIC && !defined _WIN32
+#      error "XPL_HISTOGRAM requires CLOCK_MONOTONIC, include xpl.h first, define _POSIX_C_SOURCE or XPL_HIST_CLOCK"
+#    endif /* !CLOCK_MONOTONIC && !_WIN32 */
+#    define XPL_HIST_CLOCK() _xpl_hist_clock() /**< Monotonic time in nanoseconds. */
+#  endif /* !XPL_HIST_CLOCK */
+#endif /* XPL_HISTOGRAM */
+#ifndef XPL_SNAPSHOT_SIZE
+#  define XPL_SNAPSHOT_SIZE (8 + 10 * (7 + XPL_LOOP_DEPTH + XPL_REG_COUNT)) /**< Max bytes of a context snapshot. */
+#endif /* !XPL_SNAPSHOT_SIZE */
+#ifndef XPL_LOOP_DEPTH
+#  define XPL_LOOP_DEPTH 4 /**< Max nesting depth of running 'repeat' loops. */
+#endif /* !XPL_LOOP_DEPTH */
+#ifndef XPL_BLOCK_DEPTH
+#  define XPL_BLOCK_DEPTH 16 /**< Max nesting depth of prepared blocks. */
+#endif /* !XPL_BLOCK_DEPTH */
+
+/**
+ * @brief Buildin interfaces, as initializers of an interface array.
+ */
+#ifndef XPL_FUNC_CORE
+#  define XPL_FUNC_CORE \
+      { "if", _xpl_core_if, 0 }, \
+      { "then", _xpl_core_then, 0 }, \
+      { "elseif", _xpl_core_elseif, 0 }, \
+      { "else", _xpl_core_else, 0 }, \
+      { "endif", _xpl_core_endif, 0 }, \
+      { "or", _xpl_core_or, 0 }, \
+      { "and", _xpl_core_and, 0 }, \
+      { "yield", _xpl_core_yield, 0 }, \
+      { "store", _xpl_core_store, 0 }, \
+      { "load", _xpl_core_load, 0 }, \
+      { "switch", _xpl_core_switch, 0 }, \
+      { "case", _xpl_core_case, 0 }, \
+      { "default", _xpl_core_default, 0 }, \
+      { "endswitch", _xpl_core_endswitch, 0 }, \
+      { "while", _xpl_core_while, 0 }, \
+      { "do", _xpl_core_do, 0 }, \
+      { "endwhile", _xpl_core_endwhile, 0 }, \
+      { "repeat", _xpl_core_repeat, 0 }, \
+      { "endrepeat", _xpl_core_endrepeat, 0 },
+#endif /* !XPL_FUNC_CORE */
+
 /**
  * @brief XPL scripting programming interface registering macros
  * @note The interfaces are storaged in a common array, you could put these
@@ -75,20 +226,16 @@ extern "C" {
 /**< Begins an interface declaration with buildin interfaces. */
 #  define XPL_FUNC_BEGIN(a) \
     static xpl_func_info_t a[] = { \
-      { "if", _xpl_core_if }, \
-      { "then", _xpl_core_then }, \
-      { "elseif", _xpl_core_elseif }, \
-      { "else", _xpl_core_else }, \
-      { "endif", _xpl_core_endif }, \
-      { "or", _xpl_core_or }, \
-      { "and", _xpl_core_and }, \
-      { "yield", _xpl_core_yield },
+      XPL_FUNC_CORE
 /**< Declares an interface. */
 #  define XPL_FUNC_ADD(n, f) \
-      { n, f },
+      { n, f, 0 },
+/**< Declares a load time constant interface, see xpl_func_info_t. */
+#  define XPL_FUNC_ADD_CONST(n, f) \
+      { n, f, 1 },
 /**< Ends an interface declaration. */
 #  define XPL_FUNC_END \
-      { NULL, NULL }, \
+      { NULL, NULL, 0 }, \
     };
 #endif /* !XPL_FUNC_REGISTER */
 
@@ -122,6 +269,22 @@ typedef enum xpl_status_t {
   XS_NO_PARAM,              /**< No param found. */
   XS_PARAM_TYPE_ERROR,      /**< Parameter convertion failed. */
   XS_BAD_ESCAPE_FORMAT,     /**< Bad escape format. */
+  XS_BAD_REGISTER_INDEX,    /**< Register index out of range. */
+  XS_NO_PROGRAM,            /**< Statement requires a prepared program. */
+  XS_PROGRAM_TOO_LARGE,     /**< Prepared program tables overflowed. */
+  XS_SYNTAX_ERROR,          /**< Malformed script text. */
+  XS_REGISTRY_FULL,         /**< Interface registry overflowed. */
+  XS_NAME_EXISTS,           /**< Interface name already registered. */
+  XS_NAME_NOT_FOUND,        /**< Interface name not registered. */
+  XS_POOL_EXHAUSTED,        /**< No free context left in a pool. */
+  XS_BAD_SNAPSHOT,          /**< Malformed context snapshot. */
+  XS_SNAPSHOT_MISMATCH,     /**< Snapshot taken from another script. */
+  XS_STORE_FULL,            /**< Program store overflowed. */
+  XS_BAD_STORE,             /**< Not a program store or built with other interfaces. */
+  XS_ARENA_FULL,            /**< String arena byte cap reached. */
+  XS_NO_LOCALS,             /**< Statement requires locals of the context. */
+  XS_STORE_BUSY,            /**< Store kept changing during a lookup. */
+  XS_BUDGET,                /**< Step budget ran out, could be resumed. */
   XS_COUNT
 } xpl_status_t;
 
@@ -149,6 +312,9 @@ typedef xpl_status_t (* xpl_func_t)(struct xpl_context_t* _s);
 typedef struct xpl_func_info_t {
   const char* name; /**< Interface name. */
   xpl_func_t func;  /**< Pointer to interface function. */
+  int constant;     /**< Non-zero if its result is fixed for a script's lifetime,
+                         'if' conditions made of such interfaces are evaluated once
+                         by xpl_prepare and their unreachable arms are dropped. */
 } xpl_func_info_t;
 
 /**
@@ -176,23 +342,214 @@ typedef int (* xpl_is_escape_func)(unsigned char _c);
 typedef int (* xpl_parse_escape_func)(char** _d, const char** _s);
 
 /**
- * @brief XPL context structure.
+ * @brief Jump resolved at preparing time.
  */
-typedef struct xpl_context_t {
+typedef struct xpl_jump_t {
+  int pos;    /**< Offset of the jumping statement in script text. */
+  int target; /**< Offset to jump to. */
+} xpl_jump_t;
+
+/**
+ * @brief 'case' label resolved at preparing time.
+ */
+typedef struct xpl_case_t {
+  int pos;    /**< Offset of the owner 'switch' statement. */
+  long label; /**< Constant label value. */
+  int target; /**< Offset of the case body. */
+} xpl_case_t;
+
+/**
+ * @brief Statement resolved at validating time.
+ */
+typedef struct xpl_stmt_t {
+  int pos;  /**< Offset of the statement in script text. */
+  int next; /**< Offset of its first parameter. */
+  int end;  /**< Offset right after its last parameter. */
+  int func; /**< Index of its interface in the sorted interface array, -1 for
+                 a registry interface which is looked up each time. */
+} xpl_stmt_t;
+
+/**
+ * @brief Text range of a top level block, from its opening keyword to the
+ *  end of its closing keyword.
+ */
+typedef struct xpl_span_t {
+  int begin; /**< Offset of the opening keyword. */
+  int end;   /**< Offset after the closing keyword. */
+} xpl_span_t;
+
+/**
+ * @brief Prepared program, a script text with its control flow resolved.
+ * @note A prepared program is read-only while running, it could be shared
+ *  by any contexts opened with the same interfaces.
+ */
+typedef struct xpl_program_t {
+  const char* text;                 /**< Script source text. */
+  int jumps_count;                  /**< Count of resolved jumps. */
+  int cases_count;                  /**< Count of resolved 'case' labels. */
+  xpl_jump_t jumps[XPL_JUMP_COUNT]; /**< Jumps sorted by position. */
+  xpl_case_t cases[XPL_CASE_COUNT]; /**< Labels sorted by owner and value. */
+  short case_slots[XPL_CASE_SLOTS]; /**< Labels hashed by owner and value, linearly probed,
+                                         1-based indexes into cases, 0 if empty. */
+  int spans_count;                  /**< Count of top level blocks. */
+  xpl_span_t spans[XPL_SPAN_COUNT]; /**< Top level blocks sorted by position. */
+  int validated;                    /**< Non-zero if passed xpl_validate. */
+  int stmts_count;                  /**< Count of resolved statements. */
+  xpl_stmt_t stmts[XPL_STMT_COUNT]; /**< Statements sorted by position. */
+} xpl_program_t;
+
+/**
+ * @brief Name index node of a runtime interface registry, as a ternary
+ *  search tree.
+ */
+typedef struct xpl_registry_node_t {
+  int ch;   /**< Char of this node. */
+  int lo;   /**< Node of lesser chars, 0 for none. */
+  int eq;   /**< Node of the next char, 0 for none. */
+  int hi;   /**< Node of greater chars, 0 for none. */
+  int func; /**< Slot of the interface whose name ends here, -1 for none. */
+  int up;   /**< Parent node, never read by lookups. */
+} xpl_registry_node_t;
+
+/**
+ * @brief Ring of recycled slots or nodes of a registry. Entries unlinked
+ *  during the current grace period follow those of the previous one, which
+ *  follow the free ones.
+ */
+typedef struct xpl_registry_ring_t {
+  int head;    /**< Position of the first free entry. */
+  int frees;   /**< Count of free entries. */
+  int waiting; /**< Count of entries unlinked during the previous grace period. */
+  int retired; /**< Count of entries unlinked during the current grace period. */
+} xpl_registry_ring_t;
+
+/**
+ * @brief Runtime interface registry, shared by any count of contexts.
+ * @note Registering or unregistering costs O(name length) and never moves
+ *  existing entries. A node or slot is filled before a single store links
+ *  it, so lookups running meanwhile see either the old or the new name set.
+ *  Unregistering unlinks the name and the nodes left without use, they are
+ *  recycled once every lookup which could still reach them is over: runs
+ *  and preparing enter a grace period of the registry, a writer starts a new
+ *  one and recycles what was unlinked before it when no lookup of the
+ *  previous one is left. Writers must be serialized by the caller.
+ */
+typedef struct xpl_registry_t {
+  const struct xpl_config_t* config;             /**< Configuration whose interfaces take precedence, could be NULL. */
+  xpl_func_info_t funcs[XPL_REGISTRY_COUNT];     /**< Interface slots. */
+  int funcs_count;                               /**< Count of slots ever used. */
+  xpl_registry_node_t nodes[XPL_REGISTRY_NODES]; /**< Name index, node 0 is the root. */
+  int nodes_count;                               /**< Count of nodes ever used. */
+  /**
+   * @brief Recycling.
+   */
+  /* {===== */
+    int func_ring[XPL_REGISTRY_COUNT];     /**< Recycled slots. */
+    int node_ring[XPL_REGISTRY_NODES];     /**< Recycled nodes. */
+    xpl_registry_ring_t funcs_recycled;    /**< Partition of func_ring. */
+    xpl_registry_ring_t nodes_recycled;    /**< Partition of node_ring. */
+    volatile int phase;                    /**< Parity of the current grace period. */
+    volatile long long readers[2];         /**< Lookups running in grace periods of each parity. */
+  /* =====} */
+} xpl_registry_t;
+
+#ifdef XPL_HISTOGRAM
+/**
+ * @brief Log bucketed histogram of run latencies. Recording is lock free,
+ *  histograms of different threads could be merged, and taken for
+ *  reporting while still recording.
+ */
+typedef struct xpl_hist_t {
+  volatile long long counts[XPL_HIST_BUCKETS]; /**< Runs counted by latency bucket. */
+  volatile long long count;                    /**< Count of runs. */
+  volatile long long sum;                      /**< Sum of latencies in nanoseconds. */
+  volatile long long yields;                   /**< Count of runs suspended by 'yield'. */
+  volatile long long errors;                   /**< Count of runs failed. */
+} xpl_hist_t;
+#endif /* XPL_HISTOGRAM */
+
+/**
+ * @brief XPL configuration, shared by any count of contexts.
+ */
+typedef struct xpl_config_t {
   /**
    * @brief Registered interfaces.
    */
   /* {===== */
-    xpl_func_info_t* funcs; /**< Pointer to array of registered interfaces. */
-    int funcs_count;        /**< Count of registered interfaces. */
+    xpl_func_info_t* funcs;   /**< Pointer to array of registered interfaces. */
+    int funcs_count;          /**< Count of registered interfaces. */
+    xpl_registry_t* registry; /**< Runtime registry looked up after funcs, could be NULL. */
+  /* =====} */
+  /**
+   * @brief Separator determination functor.
+   */
+  xpl_is_separator_func separator_detect;
+  /**
+   * @brief Escape determination functor.
+   */
+  xpl_is_escape_func escape_detect;
+  /**
+   * @brief Escape parser.
+   */
+  xpl_parse_escape_func escape_parse;
+  /**
+   * @brief Used to avoids function folding optimization during compiling time.
+   */
+  /* {===== */
+    int use_hack_pfunc;            /**< Use pfunc hacking if non-zero. */
+    volatile long long pfunc_hack; /**< Dummy function hack of closed contexts. */
   /* =====} */
+#ifdef XPL_HISTOGRAM
+  /**
+   * @brief Run latencies of all contexts of this configuration, could be
+   *  NULL.
+   */
+  xpl_hist_t* hist;
+#endif /* XPL_HISTOGRAM */
+} xpl_config_t;
+
+/**
+ * @brief Bump pointer arena of a context, holds strings and other data of
+ *  host interfaces for the length of a run. The memory is handed in by its
+ *  owner, its size is the byte cap.
+ */
+typedef struct xpl_arena_t {
+  char* buffer; /**< Memory of the arena. */
+  int size;     /**< Byte cap. */
+  int used;     /**< Bytes used since the last reset. */
+  int peak;     /**< Most bytes ever used between resets. */
+} xpl_arena_t;
+
+/**
+ * @brief Cold state of a context, handed in by its owner and needed only by
+ *  scripts using registers, 'repeat' loops or a string arena. Without it
+ *  those statements fail with XS_NO_LOCALS.
+ */
+typedef struct xpl_locals_t {
+  long regs[XPL_REG_COUNT];           /**< Register slots, cleared each time a script is (re)loaded. */
+  long loop_counters[XPL_LOOP_DEPTH]; /**< Remaining rounds of each running 'repeat' loop. */
+  xpl_arena_t* arena;                 /**< String arena, could be NULL. */
+} xpl_locals_t;
+
+/**
+ * @brief XPL context structure, per instance state only. Fields touched by
+ *  every step come first to share a cache line, shared settings live in the
+ *  configuration, and state only some scripts need lives in locals.
+ */
+typedef struct xpl_context_t {
   /**
    * @brief Script source code indicator.
    */
   /* {===== */
-    const char* text;   /**< Script source text. */
-    const char* cursor; /**< Script execution cursor. */
+    const char* cursor;            /**< Script execution cursor. */
+    const char* text;              /**< Script source text. */
+    const char* statement;         /**< Beginning of current statement. */
+    const xpl_program_t* program;  /**< Prepared program, NULL for plain text. */
   /* =====} */
+  /**
+   * @brief Shared configuration.
+   */
+  xpl_config_t* config;
   /**
    * @brief Boolean value.
    */
@@ -204,33 +561,121 @@ typedef struct xpl_context_t {
    * @brief Nest logic helper.
    */
   /* {===== */
-    int if_statement_depth; /**< 'if' statement depth. */
+    int if_statement_depth;             /**< 'if' statement depth. */
+    int loop_depth;                     /**< Count of running 'repeat' loops. */
   /* =====} */
   /**
-   * @brief Separator determination functor.
+   * @brief Index of the next statement of a validated program.
    */
-  xpl_is_separator_func separator_detect;
+  int stmt;
   /**
-   * @brief Escape determination functor.
+   * @brief Dummy function hack, kept per context to stay off shared lines.
    */
-  xpl_is_escape_func escape_detect;
+  int pfunc_hack;
   /**
-   * @brief Escape parser.
+   * @brief Pointer to user defined data, links free contexts in a pool.
    */
-  xpl_parse_escape_func escape_parse;
+  void* userdata;
   /**
-   * @brief Pointer to user defined data.
+   * @brief Cold state, could be NULL if no script run needs it. A clone
+   *  keeps its own.
    */
-  void* userdata;
+  xpl_locals_t* locals;
+#ifdef XPL_HISTOGRAM
   /**
-   * @brief Used to avoids function folding optimization during compiling time.
+   * @brief Run latencies of this context, could be NULL. Kept across loads,
+   *  point it to another histogram to keep scripts apart, or take it with
+   *  xpl_hist_take to start over.
    */
-  /* {===== */
-    int use_hack_pfunc; /**< Use pfunc hacking if non-zero. */
-    int pfunc_hack;     /**< Dummy function hack. */
-  /* =====} */
+  xpl_hist_t* hist;
+  /**
+   * @brief Nanoseconds spent so far by a run sliced over xpl_run_steps.
+   */
+  long long elapsed;
+#endif /* XPL_HISTOGRAM */
 } xpl_context_t;
 
+/**
+ * @brief Pool of contexts sharing one configuration, the storage is handed
+ *  in by slabs and contexts are recycled through a free list.
+ */
+typedef struct xpl_pool_t {
+  xpl_config_t* config; /**< Configuration of pooled contexts. */
+  xpl_context_t* frees; /**< Free list, linked through userdata. */
+  int frees_count;      /**< Count of free contexts. */
+  int count;            /**< Count of contexts in all slabs. */
+} xpl_pool_t;
+
+/**
+ * @brief Named program of a store, as offsets from the beginning of the
+ *  store.
+ */
+typedef struct xpl_store_entry_t {
+  int name;    /**< Offset of the name. */
+  int text;    /**< Offset of the script text. */
+  int program; /**< Offset of the prepared program. */
+} xpl_store_entry_t;
+
+/**
+ * @brief Store of prepared programs in a flat memory region, e.g. a POSIX
+ *  shared memory object or a shared file mapping. Everything inside is
+ *  addressed by offsets, so any process mapping the region at any address
+ *  runs the programs in place.
+ * @note Program data is append only and never moved. Publishing makes the
+ *  generation odd while the name table changes and even again after, so
+ *  readers retry a lookup which overlapped a change, up to
+ *  XPL_STORE_RETRIES times, and contexts running an older program are not
+ *  disturbed. Writers must be serialized by the
+ *  caller.
+ */
+typedef struct xpl_store_t {
+  char magic[4];                                /**< "xpls". */
+  int layout;                                   /**< Size of xpl_program_t when built. */
+  unsigned int funcs;                           /**< Hash of interface names when built. */
+  int funcs_count;                              /**< Count of interfaces when built. */
+  volatile unsigned int generation;             /**< Bumped twice by each publishing. */
+  int size;                                     /**< Size of the region in bytes. */
+  int used;                                     /**< Bytes used from the region. */
+  int count;                                    /**< Count of programs. */
+  xpl_store_entry_t entries[XPL_STORE_COUNT];   /**< Programs sorted by name. */
+} xpl_store_t;
+
+/**
+ * @brief Script to be prepared by a batch.
+ */
+typedef struct xpl_batch_job_t {
+  const char* text;       /**< Script source text, must outlive the program. */
+  xpl_program_t* program; /**< Program to be prepared. */
+  xpl_status_t status;    /**< Result of preparing and validating. */
+  int error;              /**< Offset of the first error, -1 if none. */
+} xpl_batch_job_t;
+
+/**
+ * @brief Jobs dealt to a worker of a batch, padded to a cache line of its
+ *  own. Any worker claims the next job by an atomic increment.
+ */
+typedef struct xpl_batch_range_t {
+  volatile long next; /**< Next unclaimed job. */
+  long end;           /**< End of the range. */
+  char pad[64 - 2 * sizeof(long)];
+} xpl_batch_range_t;
+
+/**
+ * @brief Batch preparing a set of scripts on any count of threads, each
+ *  thread works with its own context opened with the same configuration.
+ * @note Jobs are dealt to workers as contiguous ranges, a worker drains its
+ *  own range then steals from the others. Constant interfaces are called
+ *  while folding conditions, so they must be thread safe.
+ */
+typedef struct xpl_batch_t {
+  xpl_batch_job_t* jobs;                         /**< Jobs. */
+  int count;                                     /**< Count of jobs. */
+  int workers;                                   /**< Count of workers. */
+  int validate;                                  /**< Validates prepared programs if non-zero. */
+  xpl_batch_range_t ranges[XPL_BATCH_WORKERS];   /**< Jobs dealt to each worker. */
+  volatile long failed;                          /**< Count of failed jobs. */
+} xpl_batch_t;
+
 /* ========================================================} */
 
 /*
@@ -239,338 +684,2167 @@ typedef struct xpl_context_t {
 */
 
 /**
- * @brief Opens an XPL context.
+ * @brief Opens an XPL configuration.
  *
- * @param[in] _s  - XPL context.
+ * @param[in] _c  - XPL configuration.
  * @param[in] _f  - Pointer to XPL scripting interface array.
  * @param[in] _is - Separator determination functor.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_open(xpl_context_t* _s, xpl_func_info_t* _f, xpl_is_separator_func _is);
+XPLAPI xpl_status_t xpl_config_open(xpl_config_t* _c, xpl_func_info_t* _f, xpl_is_separator_func _is);
 /**
- * @brief Closes an XPL context.
+ * @brief Closes an XPL configuration, after all its contexts are closed.
  *
- * @param[in] _s - XPL context.
+ * @param[in] _c - XPL configuration.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_close(xpl_context_t* _s);
-
+XPLAPI xpl_status_t xpl_config_close(xpl_config_t* _c);
 /**
- * @brief Loads a script.
+ * @brief Opens an XPL context without locals, assign its locals field after
+ *  opening if it runs scripts which need them.
  *
  * @param[in] _s - XPL context.
+ * @param[in] _c - XPL configuration, must outlive the context.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_load(xpl_context_t* _s, const char* _t);
+XPLAPI xpl_status_t xpl_open(xpl_context_t* _s, xpl_config_t* _c);
 /**
- * @brief Reloads current script, set execution cursor to the beginning.
+ * @brief Closes an XPL context.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_reload(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_close(xpl_context_t* _s);
+
 /**
- * @brief Unloads a script.
+ * @brief Opens a context pool.
  *
- * @param[in] _s - XPL context.
+ * @param[in] _p - Context pool.
+ * @param[in] _c - XPL configuration of pooled contexts.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_unload(xpl_context_t* _s);
-
+XPLAPI xpl_status_t xpl_pool_open(xpl_pool_t* _p, xpl_config_t* _c);
 /**
- * @brief Runs a script.
+ * @brief Adds a slab of context storage to a pool.
  *
- * @param[in] _s - XPL context.
+ * @param[in] _p - Context pool.
+ * @param[in] _a - Array of contexts, must outlive the pool.
+ * @param[in] _n - Count of contexts in the array.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_run(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_pool_add(xpl_pool_t* _p, xpl_context_t* _a, int _n);
 /**
- * @brief Tries to peek one function.
+ * @brief Takes an opened context from a pool.
  *
- * @param[in] _s - XPL context.
- * @return - Returns execution status.
+ * @param[in] _p  - Context pool.
+ * @param[out] _o - Opened context.
+ * @return - Returns execution status, XS_POOL_EXHAUSTED if no free context.
  */
-XPLAPI xpl_status_t xpl_peek_func(xpl_context_t* _s, xpl_func_info_t** _f);
+XPLAPI xpl_status_t xpl_pool_alloc(xpl_pool_t* _p, xpl_context_t** _o);
 /**
- * @brief Runs a single step.
+ * @brief Closes a context and gives it back to its pool.
  *
- * @param[in] _s - XPL context.
+ * @param[in] _p - Context pool.
+ * @param[in] _s - Context taken from the pool.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_step(xpl_context_t* _s);
-
+XPLAPI xpl_status_t xpl_pool_free(xpl_pool_t* _p, xpl_context_t* _s);
 /**
- * @brief Skips a piece of comment.
+ * @brief Closes a context pool, slabs are left to their owner.
  *
- * @param[in] _s - XPL context.
+ * @param[in] _p - Context pool.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_skip_comment(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_pool_close(xpl_pool_t* _p);
+
 /**
- * @brief Determines whether there's a parameter in current XPL context at
- *  cursor point.
+ * @brief Opens a string arena, assign it to the arena field of the locals
+ *  of a context.
  *
- * @param[in] _s - XPL context.
- * @return - Returns execution status, XS_OK if there's a parameter, or
- *  XS_NO_PARAM if not.
+ * @param[in] _a - Arena.
+ * @param[in] _b - Memory of the arena, must outlive it.
+ * @param[in] _n - Size of the memory, the byte cap.
+ * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_has_param(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_arena_open(xpl_arena_t* _a, char* _b, int _n);
 /**
- * @brief Skips a string parameter from XPL context.
+ * @brief Allocates from the arena of a context, aligned to 8 bytes.
  *
- * @param[in] _s - XPL context.
- * @return - Returns execution status, XS_OK if succeed.
+ * @param[in] _s  - XPL context with locals and an arena.
+ * @param[in] _n  - Size in bytes.
+ * @param[out] _o - Allocated memory, lasts until the arena is reset.
+ * @return - Returns execution status, XS_ARENA_FULL if the byte cap is
+ *  reached.
  */
-XPLAPI xpl_status_t xpl_skip_string(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_arena_alloc(xpl_context_t* _s, int _n, void** _o);
 /**
- * @brief Pops a long integer parameter from XPL context.
+ * @brief Frees everything allocated from the arena of a context in O(1).
  *
- * @param[in] _s  - XPL context.
- * @param[out] _o - Destination buffer.
+ * @param[in] _s - XPL context with locals and an arena.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_pop_long(xpl_context_t* _s, long* _o);
+XPLAPI xpl_status_t xpl_arena_reset(xpl_context_t* _s);
+
 /**
- * @brief Pops a double float parameter from XPL context.
+ * @brief Opens a runtime interface registry, assign it to the registry
+ *  field of a configuration to make its interfaces visible to contexts.
  *
- * @param[in] _s  - XPL context.
- * @param[out] _o - Destination buffer.
+ * @param[in] _r - Registry.
+ * @param[in] _c - Configuration whose interface array is looked up before
+ *  the registry, names in it can't be registered, could be NULL.
  * @return - Returns execution status.
  */
-XPLAPI xpl_status_t xpl_pop_double(xpl_context_t* _s, double* _o);
+XPLAPI xpl_status_t xpl_registry_open(xpl_registry_t* _r, const xpl_config_t* _c);
 /**
- * @brief Pops a string parameter from XPL context.
+ * @brief Registers an interface at runtime.
  *
- * @param[in] _s  - XPL context.
- * @param[out] _o - Destination buffer.
- * @param[in] _l  - Destination buffer size.
- * @return - Returns execution status.
+ * @param[in] _r - Registry.
+ * @param[in] _i - Interface information to be copied, the name must outlive
+ *  its registration.
+ * @return - Returns execution status, XS_NAME_EXISTS if the name is taken
+ *  by the registry or by the interface array of its configuration, or
+ *  XS_REGISTRY_FULL if the registry overflowed.
  */
-XPLAPI xpl_status_t xpl_pop_string(xpl_context_t* _s, char* _o, int _l);
+XPLAPI xpl_status_t xpl_register(xpl_registry_t* _r, const xpl_func_info_t* _i);
 /**
- * @brief Pushes a boolean value to XPL context.
+ * @brief Unregisters an interface at runtime.
  *
- * @param[in] _s - XPL context.
- * @param[in] _b - Boolean value.
- * @return - Returns execution status.
+ * @param[in] _r - Registry.
+ * @param[in] _n - Interface name.
+ * @return - Returns execution status, XS_NAME_NOT_FOUND if not registered.
  */
-XPLAPI xpl_status_t xpl_push_bool(xpl_context_t* _s, int _b);
-
+XPLAPI xpl_status_t xpl_unregister(xpl_registry_t* _r, const char* _n);
 /**
- * @brief Scripting programming interface:
- *   'if' statement, dummy function.
+ * @brief Enters a grace period of a registry before looking names up, runs
+ *  and preparing do it by themselves. Interfaces found stay readable until
+ *  leaving it, even if they are unregistered meanwhile.
  *
- * @param[in] _s - XPL context.
+ * @param[in] _r  - Registry.
+ * @param[out] _o - Parity of the grace period entered.
  * @return - Returns execution status.
  */
-XPLINTERNAL xpl_status_t _xpl_core_if(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_registry_enter(xpl_registry_t* _r, int* _o);
 /**
- * @brief Scripting programming interface:
- *   'then' statement, main logic about 'if-then-elseif-else-endif'.
+ * @brief Leaves a grace period of a registry.
  *
- * @param[in] _s - XPL context.
+ * @param[in] _r - Registry.
+ * @param[in] _p - Parity returned by xpl_registry_enter.
  * @return - Returns execution status.
  */
-XPLINTERNAL xpl_status_t _xpl_core_then(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_registry_leave(xpl_registry_t* _r, int _p);
 /**
- * @brief Scripting programming interface:
- *   'elseif' statement, dummy function.
+ * @brief Looks up an interface by a name at the beginning of a text.
  *
  * @param[in] _s - XPL context.
- * @return - Returns execution status.
+ * @param[in] _k - Text beginning with a name.
+ * @return - Returns the interface found in the context's own array then in
+ *  its registry, or NULL if not found. One found in the registry stays
+ *  readable within a grace period, see xpl_registry_enter.
  */
-XPLINTERNAL xpl_status_t _xpl_core_elseif(xpl_context_t* _s);
+XPLAPI xpl_func_info_t* xpl_find_func(xpl_context_t* _s, const char* _k);
+
 /**
- * @brief Scripting programming interface:
- *   'else' statement, dummy function.
+ * @brief Loads a script.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
  */
-XPLINTERNAL xpl_status_t _xpl_core_else(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_load(xpl_context_t* _s, const char* _t);
 /**
- * @brief Scripting programming interface:
- *   'endif' statement, dummy function.
+ * @brief Reloads current script, set execution cursor to the beginning.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
  */
-XPLINTERNAL xpl_status_t _xpl_core_endif(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_reload(xpl_context_t* _s);
 /**
- * @brief Scripting programming interface:
- *   'or' statement, set current boolean composing type as OR.
+ * @brief Unloads a script.
  *
  * @param[in] _s - XPL context.
  * @return - Returns execution status.
  */
-XPLINTERNAL xpl_status_t _xpl_core_or(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_unload(xpl_context_t* _s);
+
 /**
- * @brief Scripting programming interface:
- *   'and' statement, set current boolean composing type as AND.
+ * @brief Saves the execution state of a context, e.g. suspended by 'yield',
+ *  into a portable byte string. The cursor is stored as an offset along with
+ *  a hash of the script text, integers are stored as little endian varints.
  *
- * @param[in] _s - XPL context.
- * @return - Returns execution status.
+ * @param[in] _s  - XPL context with a loaded script.
+ * @param[out] _b - Buffer, XPL_SNAPSHOT_SIZE bytes are always enough.
+ * @param[in] _n  - Size of the buffer.
+ * @param[out] _o - Count of bytes written.
+ * @return - Returns execution status, XS_NO_ENOUGH_BUFFER_SIZE if the buffer
+ *  is too small.
  */
-XPLINTERNAL xpl_status_t _xpl_core_and(xpl_context_t* _s);
+XPLAPI xpl_status_t xpl_snapshot(const xpl_context_t* _s, unsigned char* _b, int _n, int* _o);
 /**
- * @brief Scripting programming interface:
- *   'yield' statement, suspend current execution.
+ * @brief Restores the execution state of a context from a snapshot, the same
+ *  script or prepared program must have been loaded already.
  *
- * @param[in] _s - XPL context.
- * @return - Returns execution status.
+ * @param[in] _s - XPL context with a loaded script.
+ * @param[in] _b - Snapshot made by xpl_snapshot.
+ * @param[in] _n - Size of the snapshot.
+ * @return - Returns execution status, XS_SNAPSHOT_MISMATCH if the snapshot
+ *  was taken from another script, XS_BAD_SNAPSHOT if it's malformed, or
+ *  XS_NO_LOCALS if it holds registers or loops but the context has no locals.
  */
-XPLINTERNAL xpl_status_t _xpl_core_yield(xpl_context_t* _s);
-
+XPLAPI xpl_status_t xpl_restore(xpl_context_t* _s, const unsigned char* _b, int _n);
 /**
- * @brief Skips execution body of an 'if' statement.
+ * @brief Clones a context in O(1), the clone shares the configuration,
+ *  script text and prepared program of the source, and continues from the
+ *  same execution state. The destination keeps its own locals pointer, the
+ *  registers and loop counters of the source are copied into them.
  *
- * @param[in] _s - XPL context.
+ * @param[out] _d - Destination context, needn't be opened but its locals
+ *  field must be set, to NULL if not used.
+ * @param[in] _s  - Source context.
+ * @return - Returns execution status, XS_NO_LOCALS if the source has locals
+ *  but the destination doesn't.
  */
-XPLINTERNAL void _xpl_skip_ifcond_body(xpl_context_t* _s);
-
+XPLAPI xpl_status_t xpl_clone(xpl_context_t* _d, const xpl_context_t* _s);
 /**
- * @brief Determines whether a char is a single quote.
+ * @brief Prepares a script, resolves its control flow into a program.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _s  - XPL context, used to resolve interface names.
+ * @param[out] _p - Program to be prepared.
+ * @param[in] _t  - Script source text.
+ * @return - Returns execution status, XS_SYNTAX_ERROR if blocks are not
+ *  balanced.
  */
-XPLINTERNAL int _xpl_is_squote(unsigned char _c);
+XPLAPI xpl_status_t xpl_prepare(xpl_context_t* _s, xpl_program_t* _p, const char* _t);
 /**
- * @brief Determines whether a char is a double quote.
+ * @brief Validates a prepared program: balanced blocks, known interface
+ *  names, bare word parameters reading as numbers, terminated strings and
+ *  comments, and well-formed escapes. A
+ *  validated program runs through a fast path which dispatches resolved
+ *  statements without looking up names or checking them again.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _s     - XPL context, used to resolve interface names.
+ * @param[in][out] _p - Prepared program to be validated.
+ * @param[out] _e    - Offset of the first error, could be NULL.
+ * @return - Returns execution status, XS_SYNTAX_ERROR if malformed,
+ *  XS_BAD_ESCAPE_FORMAT if an escape failed to parse, or
+ *  XS_PROGRAM_TOO_LARGE if there are more than XPL_STMT_COUNT statements,
+ *  the program is left runnable through the checked path anyway.
  */
-XPLINTERNAL int _xpl_is_dquote(unsigned char _c);
+XPLAPI xpl_status_t xpl_validate(xpl_context_t* _s, xpl_program_t* _p, int* _e);
 /**
- * @brief Determines whether a char is a comma.
+ * @brief Replaces a byte range of a prepared script in place, then
+ *  prepares again only the top level blocks touched by the edit and patches
+ *  the other resolved entries by the length change. Outside of blocks a
+ *  validated program narrows that to the statements around the edit, and is
+ *  revalidated over the same range. If the edit reshapes blocks beyond that
+ *  range the whole program is prepared again.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _s      - XPL context, used to resolve interface names.
+ * @param[in][out] _p - Prepared program of _t.
+ * @param[in][out] _t - Script text buffer, the one _p was prepared from.
+ * @param[in] _n      - Capacity of _t in bytes.
+ * @param[in] _o      - Offset of the range to be replaced.
+ * @param[in] _l      - Length of the range to be replaced.
+ * @param[in] _r      - Replacement text.
+ * @return - Returns execution status, XS_NO_ENOUGH_BUFFER_SIZE if the
+ *  edited text does not fit _n and nothing is changed, otherwise the same
+ *  as xpl_prepare and xpl_validate.
  */
-XPLINTERNAL int _xpl_is_comma(unsigned char _c);
+XPLAPI xpl_status_t xpl_edit(xpl_context_t* _s, xpl_program_t* _p, char* _t, int _n, int _o, int _l, const char* _r);
 /**
- * @brief Determines whether a char is an exclamation.
+ * @brief Loads a prepared program.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _s - XPL context.
+ * @param[in] _p - Prepared program.
+ * @return - Returns execution status.
  */
-XPLINTERNAL int _xpl_is_exclamation(unsigned char _c);
+XPLAPI xpl_status_t xpl_load_program(xpl_context_t* _s, const xpl_program_t* _p);
+
 /**
- * @brief Determines whether a char is a colon.
+ * @brief Opens a batch, deals its jobs to workers.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _b - Batch.
+ * @param[in] _j - Array of jobs, texts and programs filled in.
+ * @param[in] _n - Count of jobs.
+ * @param[in] _w - Count of workers, up to XPL_BATCH_WORKERS.
+ * @param[in] _v - Validates prepared programs if non-zero.
+ * @return - Returns execution status.
  */
-XPLINTERNAL int _xpl_is_colon(unsigned char _c);
+XPLAPI xpl_status_t xpl_batch_open(xpl_batch_t* _b, xpl_batch_job_t* _j, int _n, int _w, int _v);
 /**
- * @brief Determines whether a char is a blank.
+ * @brief Works on a batch until no job is left, called by each worker
+ *  thread concurrently, or by a single thread with any worker index.
  *
- * @param[in] _c - Char to be determined.
- * @return - Returns non-zero if matching.
+ * @param[in] _b - Batch.
+ * @param[in] _s - XPL context of this worker.
+ * @param[in] _w - Index of this worker.
+ * @return - Returns execution status, the status of each script is left in
+ *  its job, and the count of failed ones in the batch.
  */
-XPLINTERNAL int _xpl_is_blank(unsigned char _c);
+XPLAPI xpl_status_t xpl_batch_work(xpl_batch_t* _b, xpl_context_t* _s, int _w);
+
 /**
- * @brief Determines whether a char is a separator.
+ * @brief Formats a memory region as an empty program store.
  *
- * @param[in] _c  - Char to be determined.
- * @param[in] _is - Separator determination functor.
- * @return - Returns non-zero if matching.
+ * @param[in] _m - Region, aligned to 8 bytes at least.
+ * @param[in] _n - Size of the region in bytes.
+ * @param[in] _c - XPL configuration whose interfaces the programs use.
+ * @param[out] _o - Store, at the beginning of the region.
+ * @return - Returns execution status, XS_STORE_FULL if the region can't
+ *  hold the store header.
  */
-XPLINTERNAL int _xpl_is_separator(unsigned char _c, xpl_is_separator_func _is);
+XPLAPI xpl_status_t xpl_store_open(void* _m, int _n, const xpl_config_t* _c, xpl_store_t** _o);
 /**
- * @brief Trims extra chars.
+ * @brief Attaches to a program store formatted by another process, the
+ *  region could be mapped read-only.
  *
- * @param[in][out] - String to be trimmed.
- * @return - Returns count of trimmed chars.
+ * @param[in] _m - Region.
+ * @param[in] _n - Size of the region in bytes.
+ * @param[in] _c - XPL configuration of contexts running the programs.
+ * @param[out] _o - Store.
+ * @return - Returns execution status, XS_BAD_STORE if the region isn't a
+ *  store, or was built with another layout or other interfaces.
  */
-XPLINTERNAL int _xpl_trim(const char** _c);
+XPLAPI xpl_status_t xpl_store_attach(const void* _m, int _n, const xpl_config_t* _c, const xpl_store_t** _o);
 /**
- * @brief Compires two strings.
+ * @brief Publishes a prepared program under a name, replacing the previous
+ *  one of the same name for later lookups.
  *
- * @param[in] _s - Source string.
- * @param[in] _d - Destination buffer.
- * @return - Returns 1 if _s > _d, -1 if _s < _d, 0 if _s = _d.
+ * @param[in] _t - Store.
+ * @param[in] _n - Program name.
+ * @param[in] _p - Prepared program, copied with its script text.
+ * @return - Returns execution status, XS_STORE_FULL if the region or the
+ *  name table overflowed.
  */
-XPLINTERNAL int _xpl_strcmp(const char* _s, const char* _d);
+XPLAPI xpl_status_t xpl_store_put(xpl_store_t* _t, const char* _n, const xpl_program_t* _p);
 /**
- * @brief Compires scripting programming interface information in quick
- *  sorting.
+ * @brief Loads a program of a store into a context, without copying.
  *
- * @param[in] _l - First interface information.
- * @param[in] _r - Second interface information.
- * @return - Returns 1 if _l > _r, -1 if _l < _r, 0 if _l = _r.
+ * @param[in] _s - XPL context opened with the configuration the store was
+ *  attached with.
+ * @param[in] _t - Store.
+ * @param[in] _n - Program name.
+ * @return - Returns execution status, XS_NAME_NOT_FOUND if not published, or
+ *  XS_STORE_BUSY if every retry overlapped a publishing, e.g. a writer died
+ *  halfway.
  */
-XPLINTERNAL int _xpl_func_info_srt_cmp(const void* _l, const void* _r);
+XPLAPI xpl_status_t xpl_store_load(xpl_context_t* _s, const xpl_store_t* _t, const char* _n);
+
 /**
- * @brief Compires scripting programming interface information in binary
- *  searching.
+ * @brief Runs a script.
  *
- * @param[in] _k - Searching key.
- * @param[in] _i - Interface information.
- * @return - Returns 1 if _k > _i, -1 if _k < _i, 0 if _k = _i.
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
  */
-XPLINTERNAL int _xpl_func_info_sch_cmp(const void* _k, const void* _i);
+XPLAPI xpl_status_t xpl_run(xpl_context_t* _s);
+/**
+ * @brief Runs a script for a limited count of steps.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _n - Max count of steps to run.
+ * @return - Returns execution status, XS_BUDGET if the budget ran out
+ *  before the script finished, or XS_SUSPENT if it executed 'yield', both
+ *  resumed by running again. The histograms get one run once it finishes,
+ *  yields or fails, with the time of all its slices.
+ */
+XPLAPI xpl_status_t xpl_run_steps(xpl_context_t* _s, int _n);
+
+#ifdef XPL_HISTOGRAM
+/**
+ * @brief Opens an empty latency histogram.
+ *
+ * @param[in] _h - Histogram.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_hist_open(xpl_hist_t* _h);
+/**
+ * @brief Records a run, called by xpl_run for the histograms of the
+ *  context and its configuration.
+ *
+ * @param[in] _h  - Histogram.
+ * @param[in] _ns - Latency in nanoseconds.
+ * @param[in] _st - Status of the run.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_hist_record(xpl_hist_t* _h, long long _ns, xpl_status_t _st);
+/**
+ * @brief Takes a snapshot of a histogram and resets it. The count of the
+ *  snapshot is the sum of its buckets, a run recorded meanwhile is counted
+ *  in either the snapshot or the histogram, but its latency, yield or error
+ *  could land on the other side than its count.
+ *
+ * @param[in] _h  - Histogram.
+ * @param[out] _o - Snapshot.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_hist_take(xpl_hist_t* _h, xpl_hist_t* _o);
+/**
+ * @brief Merges a histogram into another one.
+ *
+ * @param[in] _d - Histogram merged into.
+ * @param[in] _h - Histogram to be merged.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_hist_merge(xpl_hist_t* _d, const xpl_hist_t* _h);
+/**
+ * @brief Gets a latency quantile of a histogram.
+ *
+ * @param[in] _h - Histogram.
+ * @param[in] _q - Quantile between 0 and 1, e.g. 0.99.
+ * @return - Returns the highest latency of the bucket holding the quantile
+ *  in nanoseconds, or 0 if empty.
+ */
+XPLAPI long long xpl_hist_quantile(const xpl_hist_t* _h, double _q);
+/**
+ * @brief Prints a summary of a histogram: runs, yields, errors, mean, p50,
+ *  p99, p99.9 and max.
+ *
+ * @param[in] _h - Histogram.
+ * @param[in] _n - Name of the script or context group.
+ * @param[in] _f - Output stream.
+ * @param[in] _j - Prints a JSON object if non-zero, otherwise a text line.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_hist_print(const xpl_hist_t* _h, const char* _n, FILE* _f, int _j);
+#endif /* XPL_HISTOGRAM */
+/**
+ * @brief Tries to peek one function.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_peek_func(xpl_context_t* _s, xpl_func_info_t** _f);
+/**
+ * @brief Runs a single step.
+ * @note Unlike xpl_run, it doesn't enter a grace period of the registry,
+ *  which a caller stepping while interfaces are unregistered has to do.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_step(xpl_context_t* _s);
+/**
+ * @brief Calls an interface directly with bound parameters, as if it were
+ *  a statement of a script.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _f - Interface to be called.
+ * @param[in] _p - Parameter text, all of it must be consumed.
+ * @return - Returns execution status, XS_ERR if parameters are left.
+ */
+XPLAPI xpl_status_t xpl_call(xpl_context_t* _s, xpl_func_t _f, const char* _p);
+
+/**
+ * @brief Skips a piece of comment.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status, XS_NO_COMMENT if no comment found,
+ *  XS_SYNTAX_ERROR if the comment is not terminated.
+ */
+XPLAPI xpl_status_t xpl_skip_comment(xpl_context_t* _s);
+/**
+ * @brief Determines whether there's a parameter in current XPL context at
+ *  cursor point.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status, XS_OK if there's a parameter, or
+ *  XS_NO_PARAM if not.
+ */
+XPLAPI xpl_status_t xpl_has_param(xpl_context_t* _s);
+/**
+ * @brief Skips a string parameter from XPL context.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status, XS_OK if succeed, XS_SYNTAX_ERROR if
+ *  a string is not terminated.
+ */
+XPLAPI xpl_status_t xpl_skip_string(xpl_context_t* _s);
+/**
+ * @brief Pops a long integer parameter from XPL context.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_long(xpl_context_t* _s, long* _o);
+/**
+ * @brief Pops a double float parameter from XPL context.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_double(xpl_context_t* _s, double* _o);
+/**
+ * @brief Pops a string parameter from XPL context.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @param[in] _l  - Destination buffer size.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_string(xpl_context_t* _s, char* _o, int _l);
+/**
+ * @brief Pops a string parameter from XPL context into its string arena,
+ *  escapes processed. The string lasts until the arena is reset, which is
+ *  at the end of each run not suspended by 'yield'.
+ *
+ * @param[in] _s  - XPL context with locals and an arena.
+ * @param[out] _o - Popped string.
+ * @param[out] _l - Length of the string, could be NULL.
+ * @return - Returns execution status, XS_ARENA_FULL if the byte cap of the
+ *  arena is reached, the parameter is left to pop then.
+ */
+XPLAPI xpl_status_t xpl_pop_arena_string(xpl_context_t* _s, const char** _o, int* _l);
+/**
+ * @brief Pushes a boolean value to XPL context.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _b - Boolean value.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_push_bool(xpl_context_t* _s, int _b);
+/**
+ * @brief Pops current boolean value from XPL context, and resets it.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[out] _o - Destination buffer.
+ * @return - Returns execution status.
+ */
+XPLAPI xpl_status_t xpl_pop_bool(xpl_context_t* _s, int* _o);
+/**
+ * @brief Sets the value of a register slot.
+ *
+ * @param[in] _s - XPL context.
+ * @param[in] _i - Register index.
+ * @param[in] _v - Value to be stored.
+ * @return - Returns execution status, XS_BAD_REGISTER_INDEX if out of range,
+ *  XS_NO_LOCALS if the context has no locals.
+ */
+XPLAPI xpl_status_t xpl_set_reg(xpl_context_t* _s, int _i, long _v);
+/**
+ * @brief Gets the value of a register slot.
+ *
+ * @param[in] _s  - XPL context.
+ * @param[in] _i  - Register index.
+ * @param[out] _o - Destination buffer.
+ * @return - Returns execution status, XS_BAD_REGISTER_INDEX if out of range,
+ *  XS_NO_LOCALS if the context has no locals.
+ */
+XPLAPI xpl_status_t xpl_get_reg(xpl_context_t* _s, int _i, long* _o);
+
+/**
+ * @brief Scripting programming interface:
+ *   'if' statement, dummy function.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_if(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'then' statement, skips to the next arm if current boolean value is
+ *   false.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_then(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'elseif' statement, leaves the 'if' statement when reached from a
+ *   finished arm.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_elseif(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'else' statement, leaves the 'if' statement when reached from a
+ *   finished arm.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_else(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'endif' statement, closes an 'if' statement.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_endif(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'or' statement, set current boolean composing type as OR.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_or(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'and' statement, set current boolean composing type as AND.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_and(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'yield' statement, suspend current execution.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_yield(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'store' statement, stores current boolean value, or an optional literal
+ *   following the index, into a register slot.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_store(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'load' statement, pushes a register slot as a boolean value.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_load(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'switch' statement, jumps to the 'case' matching a register slot.
+ * @note 'switch N' dispatches on the value of register slot N, not on an
+ *  expression, as statements only evaluate to booleans; 'store' the value
+ *  to switch on first. Labels are found in O(1) by the hash of a prepared
+ *  program.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_switch(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'case' statement, leaves the 'switch' when reached from previous arm.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_case(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'default' statement, leaves the 'switch' when reached from previous arm.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_default(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'endswitch' statement, dummy function.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_endswitch(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'while' statement, dummy function.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_while(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'do' statement, leaves the 'while' loop if current boolean value is false.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_do(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'endwhile' statement, jumps back to the 'while' condition.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_endwhile(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'repeat' statement, starts a loop running a literal count of rounds.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_repeat(xpl_context_t* _s);
+/**
+ * @brief Scripting programming interface:
+ *   'endrepeat' statement, jumps back to the loop body until rounds run out.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_core_endrepeat(xpl_context_t* _s);
+
+/**
+ * @brief Skips execution body of an 'if' statement.
+ *
+ * @param[in] _s - XPL context.
+ */
+XPLINTERNAL void _xpl_skip_ifcond_body(xpl_context_t* _s);
+/**
+ * @brief Skips the rest arms of an 'if' statement after an arm finished.
+ *
+ * @param[in] _s - XPL context.
+ */
+XPLINTERNAL void _xpl_leave_ifcond(xpl_context_t* _s);
+/**
+ * @brief Moves execution cursor to the target resolved for current statement.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_jump(xpl_context_t* _s);
+/**
+ * @brief Finds the jump resolved for current statement.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns the jump, or NULL if there is no prepared program or no
+ *  jump resolved for current statement.
+ */
+XPLINTERNAL const xpl_jump_t* _xpl_find_jump(xpl_context_t* _s);
+/**
+ * @brief Evaluates an 'if' condition at preparing time, the cursor is kept.
+ *
+ * @param[in] _s - XPL context, with cursor at the beginning of a condition.
+ * @return - Returns 1 or 0 if the condition is made of constant interfaces
+ *  only, otherwise -1.
+ */
+XPLINTERNAL int _xpl_fold_cond(xpl_context_t* _s);
+/**
+ * @brief Runs a single step of a validated program.
+ *
+ * @param[in] _s - XPL context.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_step_validated(xpl_context_t* _s);
+/**
+ * @brief Resolves the control flow of a text range into a program, appends
+ *  unsorted jumps, labels and top level blocks.
+ *
+ * @param[in] _s  - XPL context, with the program text set and no program
+ *  loaded.
+ * @param[in] _p  - Program being prepared.
+ * @param[in] _b  - Offset where the range begins, at nesting depth 0.
+ * @param[in] _e  - Offset where the range ends, at nesting depth 0.
+ * @return - Returns execution status, XS_SYNTAX_ERROR if blocks are not
+ *  balanced within the range.
+ */
+XPLINTERNAL xpl_status_t _xpl_prepare_range(xpl_context_t* _s, xpl_program_t* _p, int _b, int _e);
+/**
+ * @brief Validates a text range of a program, appends unsorted statements.
+ *
+ * @param[in] _s  - XPL context, with the program text set.
+ * @param[in] _p  - Prepared program.
+ * @param[in] _b  - Offset where the range begins, at nesting depth 0.
+ * @param[in] _e  - Offset where the range ends, at nesting depth 0.
+ * @return - Returns execution status, the cursor is left at the error.
+ */
+XPLINTERNAL xpl_status_t _xpl_validate_range(xpl_context_t* _s, xpl_program_t* _p, int _b, int _e);
+/**
+ * @brief Merges unsorted entries appended to a sorted table.
+ *
+ * @param[in] _a   - Table.
+ * @param[in] _n   - Count of all entries.
+ * @param[in] _k   - Count of appended entries at the tail.
+ * @param[in] _z   - Size of an entry.
+ * @param[in] _cmp - Entry comparer.
+ */
+XPLINTERNAL void _xpl_merge(void* _a, int _n, int _k, size_t _z, int (* _cmp)(const void*, const void*));
+/**
+ * @brief Reverses entries of a table in place.
+ *
+ * @param[in] _a - First entry.
+ * @param[in] _n - Count of entries.
+ * @param[in] _z - Size of an entry.
+ */
+XPLINTERNAL void _xpl_reverse(char* _a, int _n, size_t _z);
+/**
+ * @brief Appends an unresolved jump to a program being prepared.
+ *
+ * @param[in] _p   - Program being prepared.
+ * @param[in] _pos - Offset of the jumping statement.
+ * @return - Returns execution status.
+ */
+XPLINTERNAL xpl_status_t _xpl_add_jump(xpl_program_t* _p, int _pos);
+
+/**
+ * @brief Determines whether a char is a single quote.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_squote(unsigned char _c);
+/**
+ * @brief Determines whether a char is a double quote.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_dquote(unsigned char _c);
+/**
+ * @brief Determines whether a char is a comma.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_comma(unsigned char _c);
+/**
+ * @brief Determines whether a bare word reads as a number.
+ *
+ * @param[in] _b - Beginning of the word.
+ * @param[in] _e - End of the word.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_number(const char* _b, const char* _e);
+/**
+ * @brief Determines whether a char is an exclamation.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_exclamation(unsigned char _c);
+/**
+ * @brief Determines whether a char is a colon.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_colon(unsigned char _c);
+/**
+ * @brief Determines whether a char is a blank.
+ *
+ * @param[in] _c - Char to be determined.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_blank(unsigned char _c);
+/**
+ * @brief Determines whether a char is a separator.
+ *
+ * @param[in] _c  - Char to be determined.
+ * @param[in] _is - Separator determination functor.
+ * @return - Returns non-zero if matching.
+ */
+XPLINTERNAL int _xpl_is_separator(unsigned char _c, xpl_is_separator_func _is);
+/**
+ * @brief Trims extra chars.
+ *
+ * @param[in][out] - String to be trimmed.
+ * @return - Returns count of trimmed chars.
+ */
+XPLINTERNAL int _xpl_trim(const char** _c);
+/**
+ * @brief Compires two strings.
+ *
+ * @param[in] _s - Source string.
+ * @param[in] _d - Destination buffer.
+ * @return - Returns 1 if _s > _d, -1 if _s < _d, 0 if _s = _d.
+ */
+XPLINTERNAL int _xpl_strcmp(const char* _s, const char* _d);
+/**
+ * @brief Compires scripting programming interface information in quick
+ *  sorting.
+ *
+ * @param[in] _l - First interface information.
+ * @param[in] _r - Second interface information.
+ * @return - Returns 1 if _l > _r, -1 if _l < _r, 0 if _l = _r.
+ */
+XPLINTERNAL int _xpl_func_info_srt_cmp(const void* _l, const void* _r);
+/**
+ * @brief Compires scripting programming interface information in binary
+ *  searching.
+ *
+ * @param[in] _k - Searching key.
+ * @param[in] _i - Interface information.
+ * @return - Returns 1 if _k > _i, -1 if _k < _i, 0 if _k = _i.
+ */
+XPLINTERNAL int _xpl_func_info_sch_cmp(const void* _k, const void* _i);
+/**
+ * @brief Compires resolved jumps by position.
+ *
+ * @param[in] _l - First jump.
+ * @param[in] _r - Second jump.
+ * @return - Returns 1 if _l > _r, -1 if _l < _r, 0 if _l = _r.
+ */
+XPLINTERNAL int _xpl_jump_cmp(const void* _l, const void* _r);
+/**
+ * @brief Compires resolved 'case' labels by owner position and value.
+ *
+ * @param[in] _l - First label.
+ * @param[in] _r - Second label.
+ * @return - Returns 1 if _l > _r, -1 if _l < _r, 0 if _l = _r.
+ */
+XPLINTERNAL int _xpl_case_cmp(const void* _l, const void* _r);
+/**
+ * @brief Rebuilds the 'case' label hash of a program after its labels
+ *  changed.
+ *
+ * @param[in] _p - Program.
+ */
+XPLINTERNAL void _xpl_hash_cases(xpl_program_t* _p);
+/**
+ * @brief Compires resolved statements by position.
+ *
+ * @param[in] _l - First statement.
+ * @param[in] _r - Second statement.
+ * @return - Returns 1 if _l > _r, -1 if _l < _r, 0 if _l = _r.
+ */
+XPLINTERNAL int _xpl_stmt_cmp(const void* _l, const void* _r);
+/**
+ * @brief Compires top level blocks by position.
+ *
+ * @param[in] _l - First block.
+ * @param[in] _r - Second block.
+ * @return - Returns 1 if _l > _r, -1 if _l < _r, 0 if _l = _r.
+ */
+XPLINTERNAL int _xpl_span_cmp(const void* _l, const void* _r);
+/**
+ * @brief Looks up a name node of a registry.
+ *
+ * @param[in] _r - Registry.
+ * @param[in] _k - Text beginning with a name.
+ * @return - Returns the node where the name ends, or -1 if not found.
+ */
+XPLINTERNAL int _xpl_registry_find(const xpl_registry_t* _r, const char* _k);
+/**
+ * @brief Recycles slots and nodes of a registry no lookup could still reach,
+ *  and starts a new grace period if some are left to wait.
+ *
+ * @param[in] _r - Registry.
+ */
+XPLINTERNAL void _xpl_registry_reclaim(xpl_registry_t* _r);
+/**
+ * @brief Takes a recycled or never used entry of a registry.
+ *
+ * @param[in] _g - Partition of the ring.
+ * @param[in] _a - Ring.
+ * @param[in] _n - Capacity of the ring.
+ * @param[in][out] _c - Count of entries ever used.
+ * @return - Returns the entry, or -1 if full.
+ */
+XPLINTERNAL int _xpl_registry_take(xpl_registry_ring_t* _g, const int* _a, int _n, int* _c);
+/**
+ * @brief Retires an unlinked entry of a registry, to be recycled after the
+ *  current grace period.
+ *
+ * @param[in] _g - Partition of the ring.
+ * @param[in] _a - Ring.
+ * @param[in] _n - Capacity of the ring.
+ * @param[in] _i - Entry.
+ */
+XPLINTERNAL void _xpl_registry_retire(xpl_registry_ring_t* _g, int* _a, int _n, int _i);
+#ifdef XPL_HISTOGRAM
+/**
+ * @brief Gets the bucket of a latency.
+ *
+ * @param[in] _ns - Latency in nanoseconds.
+ * @return - Returns the bucket index.
+ */
+XPLINTERNAL int _xpl_hist_bucket(long long _ns);
+/**
+ * @brief Gets the highest latency of a bucket.
+ *
+ * @param[in] _i - Bucket index.
+ * @return - Returns the latency in nanoseconds.
+ */
+XPLINTERNAL long long _xpl_hist_value(int _i);
+/**
+ * @brief Reads the monotonic clock.
+ *
+ * @return - Returns the time in nanoseconds.
+ */
+XPLINTERNAL long long _xpl_hist_clock(void);
+#endif /* XPL_HISTOGRAM */
+/**
+ * @brief Hashes the interface names of a configuration.
+ *
+ * @param[in] _c - XPL configuration.
+ * @return - Returns the hash.
+ */
+XPLINTERNAL unsigned int _xpl_funcs_hash(const xpl_config_t* _c);
+/**
+ * @brief Looks up a program of a store by name.
+ *
+ * @param[in] _t - Store.
+ * @param[in] _n - Program name.
+ * @param[out] _i - Index of the entry, or where to insert it.
+ * @return - Returns non-zero if found.
+ */
+XPLINTERNAL int _xpl_store_find(const xpl_store_t* _t, const char* _n, int* _i);
+/**
+ * @brief Hashes a script text with 32 bit FNV-1a.
+ *
+ * @param[in] _t - Script text.
+ * @return - Returns the hash.
+ */
+XPLINTERNAL unsigned int _xpl_hash(const char* _t);
+/**
+ * @brief Appends a zigzag encoded varint to a buffer.
+ *
+ * @param[in][out] _b - Buffer cursor.
+ * @param[in] _e      - End of the buffer.
+ * @param[in] _v      - Value to be appended.
+ * @return - Returns non-zero if succeed, or zero if the buffer is full.
+ */
+XPLINTERNAL int _xpl_put_varint(unsigned char** _b, const unsigned char* _e, long _v);
+/**
+ * @brief Reads a zigzag encoded varint from a buffer.
+ *
+ * @param[in][out] _b - Buffer cursor.
+ * @param[in] _e      - End of the buffer.
+ * @param[out] _v     - Value read.
+ * @return - Returns non-zero if succeed, or zero if malformed.
+ */
+XPLINTERNAL int _xpl_get_varint(const unsigned char** _b, const unsigned char* _e, long* _v);
+
+/* ========================================================} */
+
+/*
+** {========================================================
+** Function definitions
+*/
+
+XPLAPI xpl_status_t xpl_config_open(xpl_config_t* _c, xpl_func_info_t* _f, xpl_is_separator_func _is) {
+  xpl_assert(_c && _f);
+  memset(_c, 0, sizeof(xpl_config_t));
+  _c->funcs = _f;
+  while(_f[_c->funcs_count].name && _f[_c->funcs_count].func)
+    _c->funcs_count++;
+  qsort(_f, _c->funcs_count, sizeof(xpl_func_info_t), _xpl_func_info_srt_cmp);
+  _c->separator_detect = _is;
+  _c->use_hack_pfunc = 1;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_config_close(xpl_config_t* _c) {
+  xpl_assert(_c);
+  if(_c->use_hack_pfunc)
+    printf("XPL closed, pfunc_hack code: %lld\n", (long long)_c->pfunc_hack);
+  memset(_c, 0, sizeof(xpl_config_t));
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_open(xpl_context_t* _s, xpl_config_t* _c) {
+  xpl_assert(_s && _c);
+  memset(_s, 0, sizeof(xpl_context_t));
+  _s->config = _c;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_close(xpl_context_t* _s) {
+  xpl_assert(_s);
+  if(_s->config && _s->pfunc_hack)
+    xpl_atomic_add(&_s->config->pfunc_hack, _s->pfunc_hack);
+  memset(_s, 0, sizeof(xpl_context_t));
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_pool_open(xpl_pool_t* _p, xpl_config_t* _c) {
+  xpl_assert(_p && _c);
+  memset(_p, 0, sizeof(xpl_pool_t));
+  _p->config = _c;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_pool_add(xpl_pool_t* _p, xpl_context_t* _a, int _n) {
+  xpl_assert(_p && _a && _n >= 0);
+  _p->count += _n;
+  _p->frees_count += _n;
+  while(_n--) {
+    _a[_n].config = NULL;
+    _a[_n].userdata = _p->frees;
+    _p->frees = &_a[_n];
+  }
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_pool_alloc(xpl_pool_t* _p, xpl_context_t** _o) {
+  xpl_context_t* s = NULL;
+  xpl_assert(_p && _o);
+  if(!(s = _p->frees)) return XS_POOL_EXHAUSTED;
+  _p->frees = (xpl_context_t*)s->userdata;
+  _p->frees_count--;
+  *_o = s;
+
+  return xpl_open(s, _p->config);
+}
+
+XPLAPI xpl_status_t xpl_pool_free(xpl_pool_t* _p, xpl_context_t* _s) {
+  xpl_assert(_p && _s && _s->config == _p->config);
+  xpl_close(_s);
+  _s->userdata = _p->frees;
+  _p->frees = _s;
+  _p->frees_count++;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_pool_close(xpl_pool_t* _p) {
+  xpl_assert(_p);
+  memset(_p, 0, sizeof(xpl_pool_t));
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_arena_open(xpl_arena_t* _a, char* _b, int _n) {
+  xpl_assert(_a && _b && _n > 0);
+  _a->buffer = _b;
+  _a->size = _n;
+  _a->used = 0;
+  _a->peak = 0;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_arena_alloc(xpl_context_t* _s, int _n, void** _o) {
+  xpl_arena_t* a = NULL;
+  int pos = 0;
+  xpl_assert(_s && _s->locals && _s->locals->arena && _n >= 0 && _o);
+  a = _s->locals->arena;
+  pos = (int)((((size_t)a->buffer + a->used + 7) & ~(size_t)7) - (size_t)a->buffer);
+  if(pos > a->size || _n > a->size - pos) return XS_ARENA_FULL;
+  *_o = a->buffer + pos;
+  a->used = pos + _n;
+  if(a->used > a->peak) a->peak = a->used;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_arena_reset(xpl_context_t* _s) {
+  xpl_assert(_s && _s->locals && _s->locals->arena);
+  _s->locals->arena->used = 0;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_registry_open(xpl_registry_t* _r, const xpl_config_t* _c) {
+  xpl_assert(_r);
+  memset(_r, 0, sizeof(xpl_registry_t));
+  _r->config = _c;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_register(xpl_registry_t* _r, const xpl_func_info_t* _i) {
+  xpl_registry_node_t* node = NULL;
+  const char* n = NULL;
+  int* link = NULL;
+  int cur = 0;
+  int next = 0;
+  int slot = 0;
+  xpl_assert(_r && _i && _i->name && *_i->name && _i->func);
+  if(_r->config && bsearch(_i->name, _r->config->funcs, _r->config->funcs_count, sizeof(xpl_func_info_t), _xpl_func_info_sch_cmp))
+    return XS_NAME_EXISTS;
+  if((cur = _xpl_registry_find(_r, _i->name)) >= 0 && _r->nodes[cur].func >= 0) return XS_NAME_EXISTS;
+  cur = 0;
+  _xpl_registry_reclaim(_r);
+  if(!_r->funcs_recycled.frees && _r->funcs_count == XPL_REGISTRY_COUNT) return XS_REGISTRY_FULL;
+  if(_r->nodes_recycled.frees + XPL_REGISTRY_NODES - _r->nodes_count < (int)strlen(_i->name)) return XS_REGISTRY_FULL;
+  if(!_r->nodes_count) {
+    _r->nodes[0].ch = *(unsigned char*)_i->name;
+    _r->nodes[0].lo = _r->nodes[0].eq = _r->nodes[0].hi = 0;
+    _r->nodes[0].func = -1;
+    _r->nodes[0].up = 0;
+    xpl_barrier();
+    _r->nodes_count = 1;
+  }
+  /* Walks the tree, takes missing nodes, each linked once filled. */
+  for(n = _i->name; ; ) {
+    node = &_r->nodes[cur];
+    if(*(unsigned char*)n < node->ch) link = &node->lo;
+    else if(*(unsigned char*)n > node->ch) link = &node->hi;
+    else if(*++n) link = &node->eq;
+    else break;
+    if(!*link) {
+      next = _xpl_registry_take(&_r->nodes_recycled, _r->node_ring, XPL_REGISTRY_NODES, &_r->nodes_count);
+      xpl_assert(next > 0);
+      node = &_r->nodes[next];
+      node->ch = *(unsigned char*)n;
+      node->lo = node->eq = node->hi = 0;
+      node->func = -1;
+      node->up = cur;
+      xpl_barrier();
+      *link = next;
+    }
+    cur = *link;
+  }
+  slot = _xpl_registry_take(&_r->funcs_recycled, _r->func_ring, XPL_REGISTRY_COUNT, &_r->funcs_count);
+  xpl_assert(slot >= 0);
+  _r->funcs[slot] = *_i;
+  xpl_barrier();
+  _r->nodes[cur].func = slot;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_unregister(xpl_registry_t* _r, const char* _n) {
+  xpl_registry_node_t* node = NULL;
+  int cur = 0;
+  int up = 0;
+  xpl_assert(_r && _n);
+  cur = _xpl_registry_find(_r, _n);
+  if(cur < 0 || _r->nodes[cur].func < 0) return XS_NAME_NOT_FOUND;
+  node = &_r->nodes[cur];
+  _xpl_registry_retire(&_r->funcs_recycled, _r->func_ring, XPL_REGISTRY_COUNT, node->func);
+  node->func = -1;
+  /* Unlinks the nodes left without use bottom up, the root stays. */
+  while(cur && node->func < 0 && !node->lo && !node->eq && !node->hi) {
+    up = node->up;
+    if(_r->nodes[up].lo == cur) _r->nodes[up].lo = 0;
+    else if(_r->nodes[up].eq == cur) _r->nodes[up].eq = 0;
+    else _r->nodes[up].hi = 0;
+    _xpl_registry_retire(&_r->nodes_recycled, _r->node_ring, XPL_REGISTRY_NODES, cur);
+    cur = up;
+    node = &_r->nodes[cur];
+  }
+  _xpl_registry_reclaim(_r);
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_registry_enter(xpl_registry_t* _r, int* _o) {
+  int p = 0;
+  xpl_assert(_r && _o);
+  /* Counts itself in the parity read, unless a writer flipped it meanwhile
+     and would not wait for this lookup. */
+  for(;;) {
+    p = _r->phase;
+    xpl_atomic_add(&_r->readers[p], 1);
+    if(p == _r->phase) break;
+    xpl_atomic_add(&_r->readers[p], -1);
+  }
+  *_o = p;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_registry_leave(xpl_registry_t* _r, int _p) {
+  xpl_assert(_r && (_p == 0 || _p == 1));
+  xpl_atomic_add(&_r->readers[_p], -1);
+
+  return XS_OK;
+}
+
+XPLAPI xpl_func_info_t* xpl_find_func(xpl_context_t* _s, const char* _k) {
+  xpl_func_info_t* ret = NULL;
+  int node = 0;
+  xpl_assert(_s && _k);
+  ret = (xpl_func_info_t*)bsearch(_k, _s->config->funcs, _s->config->funcs_count, sizeof(xpl_func_info_t), _xpl_func_info_sch_cmp);
+  if(!ret && _s->config->registry) {
+    node = _xpl_registry_find(_s->config->registry, _k);
+    if(node >= 0 && (node = _s->config->registry->nodes[node].func) >= 0)
+      ret = &_s->config->registry->funcs[node];
+  }
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_load(xpl_context_t* _s, const char* _t) {
+  xpl_assert(_s && _t);
+  if(_s->text) xpl_unload(_s);
+  _s->statement = _s->cursor = _s->text = _t;
+  if(_s->locals) memset(_s->locals->regs, 0, sizeof(_s->locals->regs));
+  _s->loop_depth = 0;
+  _s->stmt = 0;
+#ifdef XPL_HISTOGRAM
+  _s->elapsed = 0;
+#endif /* XPL_HISTOGRAM */
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_reload(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+  _s->cursor = _s->text;
+  if(_s->locals) memset(_s->locals->regs, 0, sizeof(_s->locals->regs));
+  _s->loop_depth = 0;
+  _s->stmt = 0;
+#ifdef XPL_HISTOGRAM
+  _s->elapsed = 0;
+#endif /* XPL_HISTOGRAM */
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_unload(xpl_context_t* _s) {
+  xpl_assert(_s);
+  _s->statement = _s->cursor = _s->text = NULL;
+  _s->program = NULL;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_snapshot(const xpl_context_t* _s, unsigned char* _b, int _n, int* _o) {
+  unsigned char* b = _b;
+  const unsigned char* e = _b + _n;
+  unsigned int hash = 0;
+  int regs = _s && _s->locals ? XPL_REG_COUNT : 0;
+  int i = 0;
+  int ok = 1;
+  xpl_assert(_s && _s->text && _b && _o);
+  *_o = 0;
+  if(_n < 8) return XS_NO_ENOUGH_BUFFER_SIZE;
+  hash = _xpl_hash(_s->text);
+  *b++ = 'x'; *b++ = 'p'; *b++ = 'l'; *b++ = 1;
+  for(i = 0; i < 4; i++) *b++ = (unsigned char)(hash >> (i * 8));
+  ok = ok && _xpl_put_varint(&b, e, (long)(_s->cursor - _s->text));
+  ok = ok && _xpl_put_varint(&b, e, (long)(_s->statement - _s->text));
+  ok = ok && _xpl_put_varint(&b, e, (long)_s->bool_composing);
+  ok = ok && _xpl_put_varint(&b, e, (long)_s->bool_value);
+  ok = ok && _xpl_put_varint(&b, e, (long)_s->if_statement_depth);
+  ok = ok && _xpl_put_varint(&b, e, (long)_s->loop_depth);
+  for(i = 0; i < _s->loop_depth; i++)
+    ok = ok && _xpl_put_varint(&b, e, _s->locals->loop_counters[i]);
+  while(regs > 0 && !_s->locals->regs[regs - 1]) regs--;
+  ok = ok && _xpl_put_varint(&b, e, (long)regs);
+  for(i = 0; i < regs; i++)
+    ok = ok && _xpl_put_varint(&b, e, _s->locals->regs[i]);
+  if(!ok) return XS_NO_ENOUGH_BUFFER_SIZE;
+  *_o = (int)(b - _b);
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_restore(xpl_context_t* _s, const unsigned char* _b, int _n) {
+  const unsigned char* b = _b;
+  const unsigned char* e = _b + _n;
+  unsigned int hash = 0;
+  long v[6];
+  long loops[XPL_LOOP_DEPTH];
+  long regs[XPL_REG_COUNT];
+  long len = 0;
+  long n = 0;
+  int i = 0;
+  xpl_assert(_s && _s->text && _b);
+  if(_n < 8 || b[0] != 'x' || b[1] != 'p' || b[2] != 'l' || b[3] != 1) return XS_BAD_SNAPSHOT;
+  for(i = 0; i < 4; i++) hash |= (unsigned int)b[4 + i] << (i * 8);
+  if(hash != _xpl_hash(_s->text)) return XS_SNAPSHOT_MISMATCH;
+  b += 8;
+  for(i = 0; i < 6; i++)
+    if(!_xpl_get_varint(&b, e, &v[i])) return XS_BAD_SNAPSHOT;
+  len = (long)strlen(_s->text);
+  if(v[0] < 0 || v[0] > len || v[1] < 0 || v[1] > len) return XS_BAD_SNAPSHOT;
+  if(v[2] < XBC_NIL || v[2] > XBC_AND || v[4] < 0 || v[5] < 0 || v[5] > XPL_LOOP_DEPTH) return XS_BAD_SNAPSHOT;
+  for(i = 0; i < v[5]; i++)
+    if(!_xpl_get_varint(&b, e, &loops[i])) return XS_BAD_SNAPSHOT;
+  if(!_xpl_get_varint(&b, e, &n) || n < 0 || n > XPL_REG_COUNT) return XS_BAD_SNAPSHOT;
+  memset(regs, 0, sizeof(regs));
+  for(i = 0; i < n; i++)
+    if(!_xpl_get_varint(&b, e, &regs[i])) return XS_BAD_SNAPSHOT;
+  if(b != e) return XS_BAD_SNAPSHOT;
+  if(!_s->locals && (v[5] || n)) return XS_NO_LOCALS;
+  _s->cursor = _s->text + v[0];
+  _s->statement = _s->text + v[1];
+  _s->bool_composing = (xpl_bool_composing_t)v[2];
+  _s->bool_value = !!v[3];
+  _s->if_statement_depth = (int)v[4];
+  _s->loop_depth = (int)v[5];
+  if(_s->locals) {
+    memcpy(_s->locals->loop_counters, loops, v[5] * sizeof(long));
+    memcpy(_s->locals->regs, regs, sizeof(regs));
+  }
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_clone(xpl_context_t* _d, const xpl_context_t* _s) {
+  xpl_locals_t* locals = NULL;
+  xpl_assert(_d && _s && _s->config);
+  locals = _d->locals;
+  if(_s->locals && !locals) return XS_NO_LOCALS;
+  memcpy(_d, _s, sizeof(xpl_context_t));
+  _d->locals = locals;
+  if(locals && _s->locals && locals != _s->locals) {
+    memcpy(locals->regs, _s->locals->regs, sizeof(locals->regs));
+    memcpy(locals->loop_counters, _s->locals->loop_counters, sizeof(locals->loop_counters));
+  }
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_prepare(xpl_context_t* _s, xpl_program_t* _p, const char* _t) {
+  xpl_status_t ret = XS_OK;
+  int i = 0;
+  const char* text = NULL;
+  const char* cursor = NULL;
+  const char* statement = NULL;
+  const xpl_program_t* program = NULL;
+  xpl_bool_composing_t bool_composing = XBC_NIL;
+  int bool_value = 0;
+  xpl_registry_t* reg = NULL;
+  int parity = 0;
+  xpl_assert(_s && _p && _t);
+  memset(_p, 0, sizeof(xpl_program_t));
+  _p->text = _t;
+  text = _s->text; cursor = _s->cursor; statement = _s->statement; program = _s->program;
+  bool_composing = _s->bool_composing; bool_value = _s->bool_value;
+  _s->text = _t;
+  _s->program = NULL;
+  if((reg = _s->config->registry) != NULL) xpl_registry_enter(reg, &parity);
+  ret = _xpl_prepare_range(_s, _p, 0, (int)strlen(_t));
+  if(reg) xpl_registry_leave(reg, parity);
+  if(ret == XS_OK) {
+    qsort(_p->jumps, _p->jumps_count, sizeof(xpl_jump_t), _xpl_jump_cmp);
+    qsort(_p->cases, _p->cases_count, sizeof(xpl_case_t), _xpl_case_cmp);
+    for(i = 1; i < _p->cases_count; i++) {
+      if(!_xpl_case_cmp(&_p->cases[i - 1], &_p->cases[i])) { ret = XS_SYNTAX_ERROR; break; }
+    }
+    if(ret == XS_OK) _xpl_hash_cases(_p);
+  }
+  _s->text = text; _s->cursor = cursor; _s->statement = statement; _s->program = program;
+  _s->bool_composing = bool_composing; _s->bool_value = bool_value;
+
+  return ret;
+}
+
+XPLINTERNAL xpl_status_t _xpl_prepare_range(xpl_context_t* _s, xpl_program_t* _p, int _b, int _e) {
+  xpl_status_t ret = XS_OK;
+  xpl_func_info_t* func = NULL;
+  struct { xpl_func_t func; int pos; int jump; int alt; int start; int fold; int done; } blocks[XPL_BLOCK_DEPTH];
+  int depth = 0;
+  int loops = 0;
+  int begin = -1;
+  int pos = 0;
+  int cond = 0;
+  int i = 0;
+  const char* _t = NULL;
+  const char* prev = NULL;
+  xpl_assert(_s && _p && _s->text == _p->text && !_s->program);
+  _t = _p->text;
+  _s->cursor = _t + _b;
+  while(ret == XS_OK) {
+    XPL_SKIP_MEANINGLESS(_s);
+    if(_s->cursor > _t + _e) {
+      /* Meaningless text may run over the end of the range, if skipping it
+         from the end lands at the same place. */
+      prev = _s->cursor;
+      _s->cursor = _t + _e;
+      XPL_SKIP_MEANINGLESS(_s);
+      if(_s->cursor != prev) ret = XS_SYNTAX_ERROR;
+      break;
+    }
+    if(_s->cursor == _t + _e || *_s->cursor == '\0') break;
+    if(_xpl_is_comma(*(unsigned char*)_s->cursor)) { _s->cursor++; continue; }
+    func = xpl_find_func(_s, _s->cursor);
+    if(!func) {
+      prev = _s->cursor;
+      if((ret = xpl_skip_string(_s)) != XS_OK) break;
+      if(_s->cursor == prev) _s->cursor++;
+      continue;
+    }
+    pos = (int)(_s->cursor - _t);
+    _s->cursor += strlen(func->name);
+    if(func->func == _xpl_core_if || func->func == _xpl_core_elseif) {
+      /* 'jump' is the pending false jump of the last live 'then', 'alt' is
+         the jump of 'if' which skips leading arms folded at preparing time.
+         An 'elseif' folded to true keeps 'jump' pending, its 'then' takes
+         it straight into the arm. */
+      if(func->func == _xpl_core_if) {
+        if(depth == XPL_BLOCK_DEPTH) { ret = XS_PROGRAM_TOO_LARGE; break; }
+        blocks[depth].func = func->func;
+        blocks[depth].pos = pos;
+        blocks[depth].jump = -1;
+        blocks[depth].alt = -1;
+        blocks[depth].start = _p->jumps_count;
+        blocks[depth].done = 0;
+        depth++;
+      } else if(!depth || blocks[depth - 1].func != _xpl_core_if) {
+        ret = XS_SYNTAX_ERROR; break;
+      }
+      cond = blocks[depth - 1].done ? -1 : _xpl_fold_cond(_s);
+      if(func->func == _xpl_core_elseif) {
+        if(cond && cond != 1 && blocks[depth - 1].jump >= 0) {
+          _p->jumps[blocks[depth - 1].jump].target = pos;
+          blocks[depth - 1].jump = -1;
+        }
+        if((ret = _xpl_add_jump(_p, pos)) != XS_OK) break;
+      } else if(cond >= 0) {
+        blocks[depth - 1].alt = _p->jumps_count;
+        if((ret = _xpl_add_jump(_p, pos)) != XS_OK) break;
+      }
+      if(blocks[depth - 1].alt >= 0 && _p->jumps[blocks[depth - 1].alt].target < 0) {
+        if(cond < 0) _p->jumps[blocks[depth - 1].alt].target = (int)(_s->cursor - _t);
+        blocks[depth - 1].fold = cond < 0 ? 0 : cond ? 2 : 1;
+      } else {
+        blocks[depth - 1].fold = cond == 0 ? 1 : cond == 1 && blocks[depth - 1].jump >= 0 ? 3 : 0;
+      }
+      if(cond == 1) blocks[depth - 1].done = 1;
+    } else if(func->func == _xpl_core_then) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_if) { ret = XS_SYNTAX_ERROR; break; }
+      if(blocks[depth - 1].fold == 2) {
+        _p->jumps[blocks[depth - 1].alt].target = (int)(_s->cursor - _t);
+      } else if(blocks[depth - 1].fold == 3) {
+        /* The false 'then' before consumes this 'then' after jumping. */
+        _p->jumps[blocks[depth - 1].jump].target = pos;
+        blocks[depth - 1].jump = -1;
+      } else if(blocks[depth - 1].fold == 0) {
+        blocks[depth - 1].jump = _p->jumps_count;
+        ret = _xpl_add_jump(_p, pos);
+      }
+      blocks[depth - 1].fold = 1;
+    } else if(func->func == _xpl_core_else) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_if) { ret = XS_SYNTAX_ERROR; break; }
+      if(blocks[depth - 1].jump >= 0) {
+        _p->jumps[blocks[depth - 1].jump].target = pos;
+        blocks[depth - 1].jump = -1;
+      }
+      if(blocks[depth - 1].alt >= 0 && _p->jumps[blocks[depth - 1].alt].target < 0)
+        _p->jumps[blocks[depth - 1].alt].target = (int)(_s->cursor - _t);
+      ret = _xpl_add_jump(_p, pos);
+    } else if(func->func == _xpl_core_endif) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_if) { ret = XS_SYNTAX_ERROR; break; }
+      depth--;
+      for(i = blocks[depth].start; i < _p->jumps_count; i++) {
+        if(_p->jumps[i].target < 0) _p->jumps[i].target = pos;
+      }
+    } else if(func->func == _xpl_core_switch) {
+      if(depth == XPL_BLOCK_DEPTH) { ret = XS_PROGRAM_TOO_LARGE; break; }
+      blocks[depth].func = func->func;
+      blocks[depth].pos = pos;
+      blocks[depth].jump = _p->jumps_count;
+      blocks[depth].alt = -1;
+      depth++;
+      ret = _xpl_add_jump(_p, pos);
+    } else if(func->func == _xpl_core_case) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_switch) { ret = XS_SYNTAX_ERROR; break; }
+      if(_p->cases_count == XPL_CASE_COUNT) { ret = XS_PROGRAM_TOO_LARGE; break; }
+      if((ret = _xpl_add_jump(_p, pos)) != XS_OK) break;
+      if((ret = xpl_has_param(_s)) != XS_OK) break;
+      if((ret = xpl_pop_long(_s, &_p->cases[_p->cases_count].label)) != XS_OK) break;
+      _p->cases[_p->cases_count].pos = blocks[depth - 1].pos;
+      _p->cases[_p->cases_count].target = (int)(_s->cursor - _t);
+      _p->cases_count++;
+    } else if(func->func == _xpl_core_default) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_switch || blocks[depth - 1].alt >= 0) { ret = XS_SYNTAX_ERROR; break; }
+      ret = _xpl_add_jump(_p, pos);
+      blocks[depth - 1].alt = (int)(_s->cursor - _t);
+    } else if(func->func == _xpl_core_endswitch) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_switch) { ret = XS_SYNTAX_ERROR; break; }
+      depth--;
+      pos = (int)(_s->cursor - _t);
+      for(i = blocks[depth].jump + 1; i < _p->jumps_count; i++) {
+        if(_p->jumps[i].target < 0) _p->jumps[i].target = pos;
+      }
+      _p->jumps[blocks[depth].jump].target = blocks[depth].alt >= 0 ? blocks[depth].alt : pos;
+    } else if(func->func == _xpl_core_while || func->func == _xpl_core_repeat) {
+      if(depth == XPL_BLOCK_DEPTH) { ret = XS_PROGRAM_TOO_LARGE; break; }
+      blocks[depth].func = func->func;
+      blocks[depth].pos = pos;
+      blocks[depth].jump = -1;
+      blocks[depth].alt = -1;
+      if(func->func == _xpl_core_repeat) {
+        if(loops++ == XPL_LOOP_DEPTH) { ret = XS_PROGRAM_TOO_LARGE; break; }
+        if((ret = xpl_has_param(_s)) != XS_OK) break;
+        if((ret = xpl_skip_string(_s)) != XS_OK) break;
+        blocks[depth].jump = _p->jumps_count;
+        blocks[depth].alt = (int)(_s->cursor - _t);
+        ret = _xpl_add_jump(_p, pos);
+      }
+      depth++;
+    } else if(func->func == _xpl_core_do) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_while || blocks[depth - 1].jump >= 0) { ret = XS_SYNTAX_ERROR; break; }
+      blocks[depth - 1].jump = _p->jumps_count;
+      ret = _xpl_add_jump(_p, pos);
+    } else if(func->func == _xpl_core_endwhile || func->func == _xpl_core_endrepeat) {
+      if(!depth || blocks[depth - 1].jump < 0 ||
+        blocks[depth - 1].func != (func->func == _xpl_core_endwhile ? _xpl_core_while : _xpl_core_repeat)) {
+        ret = XS_SYNTAX_ERROR; break;
+      }
+      depth--;
+      if(func->func == _xpl_core_endrepeat) loops--;
+      if((ret = _xpl_add_jump(_p, pos)) != XS_OK) break;
+      _p->jumps[_p->jumps_count - 1].target = func->func == _xpl_core_endwhile ? blocks[depth].pos : blocks[depth].alt;
+      _p->jumps[blocks[depth].jump].target = (int)(_s->cursor - _t);
+    }
+    if(ret == XS_OK && depth && begin < 0) {
+      begin = pos;
+    } else if(ret == XS_OK && !depth && begin >= 0) {
+      if(_p->spans_count == XPL_SPAN_COUNT) { ret = XS_PROGRAM_TOO_LARGE; break; }
+      _p->spans[_p->spans_count].begin = begin;
+      _p->spans[_p->spans_count].end = (int)(_s->cursor - _t);
+      _p->spans_count++;
+      begin = -1;
+    }
+  }
+  if(ret == XS_OK && depth) ret = XS_SYNTAX_ERROR;
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_validate(xpl_context_t* _s, xpl_program_t* _p, int* _e) {
+  xpl_status_t ret = XS_OK;
+  const char* text = NULL;
+  const char* cursor = NULL;
+  const char* statement = NULL;
+  xpl_registry_t* reg = NULL;
+  int parity = 0;
+  xpl_assert(_s && _p && _p->text);
+  _p->validated = 0;
+  _p->stmts_count = 0;
+  text = _s->text; cursor = _s->cursor; statement = _s->statement;
+  _s->text = _p->text;
+  if((reg = _s->config->registry) != NULL) xpl_registry_enter(reg, &parity);
+  ret = _xpl_validate_range(_s, _p, 0, (int)strlen(_p->text));
+  if(reg) xpl_registry_leave(reg, parity);
+  if(_e) *_e = (int)(_s->cursor - _p->text);
+  if(ret == XS_OK) _p->validated = 1;
+  else _p->stmts_count = 0;
+  _s->text = text; _s->cursor = cursor; _s->statement = statement;
+
+  return ret;
+}
+
+XPLINTERNAL xpl_status_t _xpl_validate_range(xpl_context_t* _s, xpl_program_t* _p, int _b, int _e) {
+  xpl_status_t ret = XS_OK;
+  xpl_func_info_t* func = NULL;
+  xpl_func_t f = NULL;
+  struct { xpl_func_t func; int body; } blocks[XPL_BLOCK_DEPTH];
+  int depth = 0;
+  int need = 0;
+  int allow = 0;
+  const char* prev = NULL;
+  xpl_assert(_s && _p && _s->text == _p->text);
+  _s->cursor = _p->text + _b;
+  for(;;) {
+    /* A block statement expects an interface right after it, a host
+       interface takes any count of parameters. */
+    do {
+      _xpl_trim(&_s->cursor);
+      prev = _s->cursor;
+    } while((ret = xpl_skip_comment(_s)) == XS_OK);
+    if(ret != XS_NO_COMMENT) { _s->cursor = prev; break; }
+    ret = XS_OK;
+    if(_s->cursor > _p->text + _e) {
+      prev = _s->cursor;
+      _s->cursor = _p->text + _e;
+      XPL_SKIP_MEANINGLESS(_s);
+      if(_s->cursor != prev || need > 0) ret = XS_SYNTAX_ERROR;
+      break;
+    }
+    if(_s->cursor == _p->text + _e || *_s->cursor == '\0' || _xpl_is_comma(*(unsigned char*)_s->cursor)) {
+      if(need > 0) { ret = XS_SYNTAX_ERROR; break; }
+      if(_s->cursor == _p->text + _e || *_s->cursor == '\0') break;
+      allow = 0;
+      _s->cursor++;
+      continue;
+    }
+    func = _xpl_is_dquote(*(unsigned char*)_s->cursor) ? NULL :
+      xpl_find_func(_s, _s->cursor);
+    if(!func) {
+      /* A bare word which is not an interface must be a number, so a
+         misspelt name is never taken as a parameter. */
+      if(!allow) { ret = XS_SYNTAX_ERROR; break; }
+      if(allow > 0) allow--;
+      if(need > 0) need--;
+      prev = _s->cursor;
+      if((ret = xpl_skip_string(_s)) != XS_OK) break;
+      if(_s->cursor == prev || _s->cursor > _p->text + _e) { ret = XS_SYNTAX_ERROR; break; }
+      if(!_xpl_is_dquote(*(unsigned char*)prev) && !_xpl_is_number(prev, _s->cursor)) { _s->cursor = prev; ret = XS_SYNTAX_ERROR; break; }
+      _p->stmts[_p->stmts_count - 1].end = (int)(_s->cursor - _p->text);
+      continue;
+    }
+    if(need > 0) { ret = XS_SYNTAX_ERROR; break; }
+    if(_p->stmts_count == XPL_STMT_COUNT) { ret = XS_PROGRAM_TOO_LARGE; break; }
+    _p->stmts[_p->stmts_count].pos = (int)(_s->cursor - _p->text);
+    _p->stmts[_p->stmts_count].func = func >= _s->config->funcs && func < _s->config->funcs + _s->config->funcs_count ? (int)(func - _s->config->funcs) : -1;
+    _s->cursor += strlen(func->name);
+    prev = _s->cursor;
+    XPL_SKIP_MEANINGLESS(_s);
+    _p->stmts[_p->stmts_count].next = (int)(_s->cursor - _p->text);
+    _p->stmts[_p->stmts_count].end = (int)(prev - _p->text);
+    _p->stmts_count++;
+    _s->cursor = prev;
+    f = func->func;
+    need = allow = 0;
+    if(f == _xpl_core_store) { need = 1; allow = 2; }
+    else if(f == _xpl_core_load || f == _xpl_core_switch || f == _xpl_core_case || f == _xpl_core_repeat) need = allow = 1;
+    if(f == _xpl_core_if || f == _xpl_core_while || f == _xpl_core_repeat || f == _xpl_core_switch) {
+      if(depth == XPL_BLOCK_DEPTH) { ret = XS_PROGRAM_TOO_LARGE; break; }
+      blocks[depth].func = f;
+      blocks[depth].body = f == _xpl_core_repeat;
+      depth++;
+    } else if(f == _xpl_core_then || f == _xpl_core_do) {
+      if(!depth || blocks[depth - 1].func != (f == _xpl_core_then ? _xpl_core_if : _xpl_core_while) || blocks[depth - 1].body) { ret = XS_SYNTAX_ERROR; break; }
+      blocks[depth - 1].body = 1;
+    } else if(f == _xpl_core_elseif || f == _xpl_core_else) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_if || blocks[depth - 1].body != 1) { ret = XS_SYNTAX_ERROR; break; }
+      blocks[depth - 1].body = f == _xpl_core_else ? 2 : 0;
+    } else if(f == _xpl_core_case || f == _xpl_core_default) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_switch) { ret = XS_SYNTAX_ERROR; break; }
+      blocks[depth - 1].body = 1;
+    } else if(f == _xpl_core_endif || f == _xpl_core_endwhile || f == _xpl_core_endrepeat || f == _xpl_core_endswitch) {
+      if(!depth || !blocks[depth - 1].body ||
+        blocks[depth - 1].func != (f == _xpl_core_endif ? _xpl_core_if : f == _xpl_core_endwhile ? _xpl_core_while :
+          f == _xpl_core_endrepeat ? _xpl_core_repeat : _xpl_core_switch)) {
+        ret = XS_SYNTAX_ERROR; break;
+      }
+      depth--;
+    } else if(depth && blocks[depth - 1].func == _xpl_core_switch && !blocks[depth - 1].body) {
+      ret = XS_SYNTAX_ERROR; break;
+    } else if(!f || (f != _xpl_core_or && f != _xpl_core_and && f != _xpl_core_yield && f != _xpl_core_store && f != _xpl_core_load)) {
+      allow = -1;
+    }
+  }
+  if(ret == XS_OK && depth) ret = XS_SYNTAX_ERROR;
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_edit(xpl_context_t* _s, xpl_program_t* _p, char* _t, int _n, int _o, int _l, const char* _r) {
+  xpl_status_t ret = XS_OK;
+  int len = 0;
+  int rlen = 0;
+  int delta = 0;
+  int b = 0;
+  int e = 0;
+  int jumps = 0;
+  int cases = 0;
+  int spans = 0;
+  int stmts = 0;
+  int validated = 0;
+  int inner = 0;
+  int prev = -1;
+  int i = 0;
+  const char* text = NULL;
+  const char* cursor = NULL;
+  const char* statement = NULL;
+  const xpl_program_t* program = NULL;
+  xpl_bool_composing_t bool_composing = XBC_NIL;
+  int bool_value = 0;
+  xpl_registry_t* reg = NULL;
+  int parity = 0;
+  xpl_assert(_s && _p && _t && _r && _t == _p->text);
+  len = (int)strlen(_t);
+  rlen = (int)strlen(_r);
+  xpl_assert(_o >= 0 && _l >= 0 && _o + _l <= len);
+  delta = rlen - _l;
+  if(len + delta + 1 > _n) return XS_NO_ENOUGH_BUFFER_SIZE;
+  /* Widens the edit to the top level blocks or gaps between them it
+     touches, both ends are statement boundaries at nesting depth 0. */
+  b = 0; e = len;
+  for(i = 0; i < _p->spans_count; i++) {
+    if(_p->spans[i].end <= _o) { b = _p->spans[i].end; continue; }
+    if(_p->spans[i].begin <= _o) { b = _p->spans[i].begin; inner |= 1; }
+    break;
+  }
+  for(i = _p->spans_count - 1; i >= 0; i--) {
+    if(_p->spans[i].begin >= _o + _l) { e = _p->spans[i].begin; continue; }
+    if(_p->spans[i].end > _o + _l) { e = _p->spans[i].end; inner |= 2; }
+    break;
+  }
+  /* An end lying in a gap narrows further to statement boundaries, keeping
+     the statement before the edit which could take its parameters. */
+  if(_p->validated) {
+    for(i = 0; i < _p->stmts_count && _p->stmts[i].pos < e; i++) {
+      if(_p->stmts[i].pos < b) continue;
+      if(_p->stmts[i].pos <= _o) {
+        if(!(inner & 1)) { if(prev >= 0) b = prev; prev = _p->stmts[i].pos; }
+      } else if(_p->stmts[i].pos > _o + _l) {
+        if(!(inner & 2)) e = _p->stmts[i].pos;
+        break;
+      }
+    }
+  }
+  memmove(_t + _o + rlen, _t + _o + _l, len - _o - _l + 1);
+  memcpy(_t + _o, _r, rlen);
+#define _XPL_SPLICE(a, c, k, m) \
+  do { \
+    int _i = 0, _j = 0; \
+    for(_i = 0; _i < _p->c; _i++) { \
+      if(_p->a[_i].k >= b && _p->a[_i].k < e) continue; \
+      if(_p->a[_i].k >= e) { _p->a[_i].k += delta; _p->a[_i].m += delta; } \
+      _p->a[_j++] = _p->a[_i]; \
+    } \
+    _p->c = _j; \
+  } while(0)
+  _XPL_SPLICE(jumps, jumps_count, pos, target);
+  _XPL_SPLICE(cases, cases_count, pos, target);
+  _XPL_SPLICE(spans, spans_count, begin, end);
+  _XPL_SPLICE(stmts, stmts_count, pos, next);
+#undef _XPL_SPLICE
+  for(i = 0; i < _p->stmts_count; i++) {
+    if(_p->stmts[i].pos >= e + delta) _p->stmts[i].end += delta;
+  }
+  jumps = _p->jumps_count; cases = _p->cases_count; spans = _p->spans_count; stmts = _p->stmts_count;
+  validated = _p->validated;
+  text = _s->text; cursor = _s->cursor; statement = _s->statement; program = _s->program;
+  bool_composing = _s->bool_composing; bool_value = _s->bool_value;
+  _s->text = _t;
+  _s->program = NULL;
+  if((reg = _s->config->registry) != NULL) xpl_registry_enter(reg, &parity);
+  if(b && !_xpl_is_separator(*(unsigned char*)(_t + b - 1), _s->config->separator_detect) &&
+    !_xpl_is_separator(*(unsigned char*)(_t + b), _s->config->separator_detect) && _t[b]) {
+    ret = XS_SYNTAX_ERROR;
+  } else {
+    ret = _xpl_prepare_range(_s, _p, b, e + delta);
+  }
+  if(ret == XS_OK) {
+    _xpl_merge(_p->jumps, _p->jumps_count, _p->jumps_count - jumps, sizeof(xpl_jump_t), _xpl_jump_cmp);
+    _xpl_merge(_p->cases, _p->cases_count, _p->cases_count - cases, sizeof(xpl_case_t), _xpl_case_cmp);
+    _xpl_merge(_p->spans, _p->spans_count, _p->spans_count - spans, sizeof(xpl_span_t), _xpl_span_cmp);
+    for(i = 1; i < _p->cases_count; i++) {
+      if(!_xpl_case_cmp(&_p->cases[i - 1], &_p->cases[i])) { ret = XS_SYNTAX_ERROR; break; }
+    }
+    if(ret == XS_OK) _xpl_hash_cases(_p);
+  }
+  if(ret == XS_OK && validated) {
+    if(_xpl_validate_range(_s, _p, b, e + delta) == XS_OK) {
+      /* The statement right before the range skips meaningless text into
+         it to find the next one. */
+      _s->cursor = _t + b;
+      XPL_SKIP_MEANINGLESS(_s);
+      for(i = 0; i < stmts && _p->stmts[i].pos < b; i++) {
+        if(_p->stmts[i].next >= b) _p->stmts[i].next = (int)(_s->cursor - _t);
+      }
+      _xpl_merge(_p->stmts, _p->stmts_count, _p->stmts_count - stmts, sizeof(xpl_stmt_t), _xpl_stmt_cmp);
+    } else {
+      validated = -1;
+    }
+  }
+  if(reg) xpl_registry_leave(reg, parity);
+  _s->text = text; _s->cursor = cursor; _s->statement = statement; _s->program = program;
+  _s->bool_composing = bool_composing; _s->bool_value = bool_value;
+  /* The edit reshaped blocks beyond the widened range, or broke a token
+     across its bounds, falls back to a full pass. */
+  if(ret != XS_OK) {
+    if((ret = xpl_prepare(_s, _p, _t)) == XS_OK && validated)
+      ret = xpl_validate(_s, _p, NULL);
+  } else if(validated < 0) {
+    ret = xpl_validate(_s, _p, NULL);
+  }
+
+  return ret;
+}
+
+XPLAPI xpl_status_t xpl_load_program(xpl_context_t* _s, const xpl_program_t* _p) {
+  xpl_assert(_s && _p && _p->text);
+  xpl_load(_s, _p->text);
+  _s->program = _p;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_batch_open(xpl_batch_t* _b, xpl_batch_job_t* _j, int _n, int _w, int _v) {
+  int i = 0;
+  xpl_assert(_b && (_j || !_n) && _n >= 0 && _w > 0 && _w <= XPL_BATCH_WORKERS);
+  memset(_b, 0, sizeof(xpl_batch_t));
+  _b->jobs = _j;
+  _b->count = _n;
+  _b->workers = _w;
+  _b->validate = _v;
+  for(i = 0; i < _w; i++) {
+    _b->ranges[i].next = (long)_n * i / _w;
+    _b->ranges[i].end = (long)_n * (i + 1) / _w;
+  }
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_batch_work(xpl_batch_t* _b, xpl_context_t* _s, int _w) {
+  xpl_batch_job_t* job = NULL;
+  xpl_batch_range_t* r = NULL;
+  long j = 0;
+  int i = 0;
+  xpl_assert(_b && _s && _w >= 0);
+  for(i = 0; i < _b->workers; i++) {
+    r = &_b->ranges[(_w + i) % _b->workers];
+    while(r->next < r->end && (j = xpl_atomic_inc(&r->next)) < r->end) {
+      job = &_b->jobs[j];
+      job->error = -1;
+      job->status = xpl_prepare(_s, job->program, job->text);
+      if(job->status == XS_OK && _b->validate) {
+        job->status = xpl_validate(_s, job->program, &job->error);
+      } else if(job->status != XS_OK) {
+        /* Locates the error by validating, the program stays unusable. */
+        if(xpl_validate(_s, job->program, &job->error) == XS_OK) job->error = -1;
+        job->program->validated = 0;
+        job->program->stmts_count = 0;
+      }
+      if(job->status != XS_OK) xpl_atomic_inc(&_b->failed);
+    }
+  }
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_store_open(void* _m, int _n, const xpl_config_t* _c, xpl_store_t** _o) {
+  xpl_store_t* t = (xpl_store_t*)_m;
+  xpl_assert(_m && !((size_t)_m & 7) && _c && _o);
+  if(_n < (int)sizeof(xpl_store_t)) return XS_STORE_FULL;
+  memset(t, 0, sizeof(xpl_store_t));
+  t->layout = (int)sizeof(xpl_program_t);
+  t->funcs = _xpl_funcs_hash(_c);
+  t->funcs_count = _c->funcs_count;
+  t->size = _n;
+  t->used = ((int)sizeof(xpl_store_t) + 7) & ~7;
+  xpl_barrier();
+  memcpy(t->magic, "xpls", 4);
+  *_o = t;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_store_attach(const void* _m, int _n, const xpl_config_t* _c, const xpl_store_t** _o) {
+  const xpl_store_t* t = (const xpl_store_t*)_m;
+  xpl_assert(_m && !((size_t)_m & 7) && _c && _o);
+  if(_n < (int)sizeof(xpl_store_t) || memcmp(t->magic, "xpls", 4) || t->size > _n ||
+    t->layout != (int)sizeof(xpl_program_t) || t->funcs_count != _c->funcs_count || t->funcs != _xpl_funcs_hash(_c)) {
+    return XS_BAD_STORE;
+  }
+  *_o = t;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_store_put(xpl_store_t* _t, const char* _n, const xpl_program_t* _p) {
+  char* base = (char*)_t;
+  xpl_program_t* prog = NULL;
+  int name = 0;
+  int text = 0;
+  int size = 0;
+  int found = 0;
+  int i = 0;
+  unsigned int gen = 0;
+  xpl_assert(_t && _n && _p && _p->text);
+  found = _xpl_store_find(_t, _n, &i);
+  if(!found && _t->count == XPL_STORE_COUNT) return XS_STORE_FULL;
+  /* Only the used part of the statement table is stored. */
+  name = (int)strlen(_n) + 1;
+  text = (int)strlen(_p->text) + 1;
+  size = (int)((char*)&_p->stmts[_p->stmts_count] - (char*)_p);
+  if(_t->size - _t->used < ((name + text + 7) & ~7) + ((size + 7) & ~7)) return XS_STORE_FULL;
+  prog = (xpl_program_t*)(base + _t->used);
+  memcpy(prog, _p, size);
+  prog->text = NULL;
+  memcpy(base + _t->used + ((size + 7) & ~7), _n, name);
+  memcpy(base + _t->used + ((size + 7) & ~7) + name, _p->text, text);
+  gen = _t->generation;
+  _t->generation = gen + 1;
+  xpl_barrier();
+  if(!found) {
+    memmove(&_t->entries[i + 1], &_t->entries[i], (_t->count - i) * sizeof(xpl_store_entry_t));
+    _t->count++;
+  }
+  _t->entries[i].program = _t->used;
+  _t->entries[i].name = _t->used + ((size + 7) & ~7);
+  _t->entries[i].text = _t->entries[i].name + name;
+  xpl_barrier();
+  _t->generation = gen + 2;
+  _t->used += ((size + 7) & ~7) + ((name + text + 7) & ~7);
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_store_load(xpl_context_t* _s, const xpl_store_t* _t, const char* _n) {
+  const char* base = (const char*)_t;
+  xpl_store_entry_t entry;
+  unsigned int gen = 0;
+  int tries = 0;
+  int found = 0;
+  int i = 0;
+  xpl_assert(_s && _t && _n && _s->config->funcs_count == _t->funcs_count);
+  for(tries = 0; tries < XPL_STORE_RETRIES; tries++) {
+    if((gen = _t->generation) & 1) continue;
+    xpl_barrier();
+    if((found = _xpl_store_find(_t, _n, &i)) != 0) entry = _t->entries[i];
+    xpl_barrier();
+    if(gen == _t->generation) break;
+  }
+  if(tries == XPL_STORE_RETRIES) return XS_STORE_BUSY;
+  if(!found) return XS_NAME_NOT_FOUND;
+  xpl_load(_s, base + entry.text);
+  _s->program = (const xpl_program_t*)(base + entry.program);
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_run(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  xpl_registry_t* reg = NULL;
+  int parity = 0;
+#ifdef XPL_HISTOGRAM
+  xpl_hist_t* hist = NULL;
+  xpl_hist_t* group = NULL;
+  long long begin = 0;
+#endif /* XPL_HISTOGRAM */
+  xpl_assert(_s && _s->text && "Empty program");
+#ifdef XPL_HISTOGRAM
+  hist = _s->hist;
+  group = _s->config->hist;
+  if(hist || group) begin = XPL_HIST_CLOCK();
+#endif /* XPL_HISTOGRAM */
+  if((reg = _s->config->registry) != NULL) xpl_registry_enter(reg, &parity);
+  while(*_s->cursor && ret == XS_OK)
+    ret = xpl_step(_s);
+  if(reg) xpl_registry_leave(reg, parity);
+  if(_s->locals && _s->locals->arena && ret != XS_SUSPENT) _s->locals->arena->used = 0;
+#ifdef XPL_HISTOGRAM
+  if(hist || group) {
+    begin = XPL_HIST_CLOCK() - begin;
+    if(hist) xpl_hist_record(hist, begin, ret);
+    if(group) xpl_hist_record(group, begin, ret);
+  }
+#endif /* XPL_HISTOGRAM */
+
+  return ret;
+}
 
-/* ========================================================} */
+XPLAPI xpl_status_t xpl_run_steps(xpl_context_t* _s, int _n) {
+  xpl_status_t ret = XS_OK;
+  xpl_registry_t* reg = NULL;
+  int parity = 0;
+#ifdef XPL_HISTOGRAM
+  xpl_hist_t* hist = NULL;
+  xpl_hist_t* group = NULL;
+  long long begin = 0;
+#endif /* XPL_HISTOGRAM */
+  xpl_assert(_s && _s->text && "Empty program");
+#ifdef XPL_HISTOGRAM
+  hist = _s->hist;
+  group = _s->config->hist;
+  if(hist || group) begin = XPL_HIST_CLOCK();
+#endif /* XPL_HISTOGRAM */
+  if((reg = _s->config->registry) != NULL) xpl_registry_enter(reg, &parity);
+  while(*_s->cursor && ret == XS_OK && _n-- > 0)
+    ret = xpl_step(_s);
+  if(reg) xpl_registry_leave(reg, parity);
+  if(ret == XS_OK && *_s->cursor) ret = XS_BUDGET;
+  if(_s->locals && _s->locals->arena && ret != XS_SUSPENT && ret != XS_BUDGET) _s->locals->arena->used = 0;
+#ifdef XPL_HISTOGRAM
+  if(hist || group) {
+    _s->elapsed += XPL_HIST_CLOCK() - begin;
+    if(ret != XS_BUDGET) {
+      if(hist) xpl_hist_record(hist, _s->elapsed, ret);
+      if(group) xpl_hist_record(group, _s->elapsed, ret);
+      _s->elapsed = 0;
+    }
+  }
+#endif /* XPL_HISTOGRAM */
 
-/*
-** {========================================================
-** Function definitions
-*/
+  return ret;
+}
 
-XPLAPI xpl_status_t xpl_open(xpl_context_t* _s, xpl_func_info_t* _f, xpl_is_separator_func _is) {
-  xpl_assert(_s && _f);
-  memset(_s, 0, sizeof(xpl_context_t));
-  _s->funcs = _f;
-  while(_f[_s->funcs_count].name && _f[_s->funcs_count].func)
-    _s->funcs_count++;
-  qsort(_f, _s->funcs_count, sizeof(xpl_func_info_t), _xpl_func_info_srt_cmp);
-  _s->separator_detect = _is;
-  _s->use_hack_pfunc = 1;
+#ifdef XPL_HISTOGRAM
+XPLAPI xpl_status_t xpl_hist_open(xpl_hist_t* _h) {
+  xpl_assert(_h);
+  memset((void*)_h, 0, sizeof(xpl_hist_t));
 
   return XS_OK;
 }
 
-XPLAPI xpl_status_t xpl_close(xpl_context_t* _s) {
-  xpl_assert(_s);
-  if(_s->use_hack_pfunc)
-    printf("XPL closed, pfunc_hack code: %d\n", _s->pfunc_hack);
-  memset(_s, 0, sizeof(xpl_context_t));
+XPLAPI xpl_status_t xpl_hist_record(xpl_hist_t* _h, long long _ns, xpl_status_t _st) {
+  xpl_assert(_h);
+  if(_ns < 0) _ns = 0;
+  xpl_atomic_add(&_h->counts[_xpl_hist_bucket(_ns)], 1);
+  xpl_atomic_add(&_h->count, 1);
+  xpl_atomic_add(&_h->sum, _ns);
+  if(_st == XS_SUSPENT) xpl_atomic_add(&_h->yields, 1);
+  else if(_st != XS_OK) xpl_atomic_add(&_h->errors, 1);
 
   return XS_OK;
 }
 
-XPLAPI xpl_status_t xpl_load(xpl_context_t* _s, const char* _t) {
-  xpl_assert(_s && _t);
-  if(_s->text) xpl_unload(_s);
-  _s->cursor = _s->text = _t;
+XPLAPI xpl_status_t xpl_hist_take(xpl_hist_t* _h, xpl_hist_t* _o) {
+  long long n = 0;
+  long long c = 0;
+  int i = 0;
+  xpl_assert(_h && _o && _h != _o);
+  /* Counts are summed from buckets, so both sides agree with their buckets
+     once concurrent recordings finished. */
+  for(i = 0; i < XPL_HIST_BUCKETS; i++) {
+    c = xpl_atomic_xchg(&_h->counts[i], 0);
+    _o->counts[i] = c;
+    n += c;
+  }
+  _o->count = n;
+  xpl_atomic_add(&_h->count, -n);
+  _o->sum = xpl_atomic_xchg(&_h->sum, 0);
+  _o->yields = xpl_atomic_xchg(&_h->yields, 0);
+  _o->errors = xpl_atomic_xchg(&_h->errors, 0);
 
   return XS_OK;
 }
 
-XPLAPI xpl_status_t xpl_reload(xpl_context_t* _s) {
-  xpl_assert(_s && _s->text);
-  _s->cursor = _s->text;
+XPLAPI xpl_status_t xpl_hist_merge(xpl_hist_t* _d, const xpl_hist_t* _h) {
+  int i = 0;
+  xpl_assert(_d && _h && _d != _h);
+  for(i = 0; i < XPL_HIST_BUCKETS; i++) {
+    if(_h->counts[i]) xpl_atomic_add(&_d->counts[i], _h->counts[i]);
+  }
+  xpl_atomic_add(&_d->count, _h->count);
+  xpl_atomic_add(&_d->sum, _h->sum);
+  xpl_atomic_add(&_d->yields, _h->yields);
+  xpl_atomic_add(&_d->errors, _h->errors);
 
   return XS_OK;
 }
 
-XPLAPI xpl_status_t xpl_unload(xpl_context_t* _s) {
-  xpl_assert(_s);
-  _s->cursor = _s->text = NULL;
+XPLAPI long long xpl_hist_quantile(const xpl_hist_t* _h, double _q) {
+  long long rank = 0;
+  long long n = 0;
+  int i = 0;
+  xpl_assert(_h && _q >= 0.0 && _q <= 1.0);
+  if(_h->count <= 0) return 0;
+  rank = (long long)(_q * _h->count + 0.999999);
+  if(rank < 1) rank = 1;
+  for(i = 0; i < XPL_HIST_BUCKETS; i++) {
+    if((n += _h->counts[i]) >= rank) return _xpl_hist_value(i);
+  }
 
-  return XS_OK;
+  return _xpl_hist_value(XPL_HIST_BUCKETS - 1);
 }
 
-XPLAPI xpl_status_t xpl_run(xpl_context_t* _s) {
-  xpl_status_t ret = XS_OK;
-  xpl_assert(_s && _s->text && "Empty program");
-  while(*_s->cursor && ret == XS_OK)
-    ret = xpl_step(_s);
+XPLAPI xpl_status_t xpl_hist_print(const xpl_hist_t* _h, const char* _n, FILE* _f, int _j) {
+  long long q[4] = { 0 };
+  double mean = 0.0;
+  const char* c = NULL;
+  xpl_assert(_h && _n && _f);
+  q[0] = xpl_hist_quantile(_h, 0.5);
+  q[1] = xpl_hist_quantile(_h, 0.99);
+  q[2] = xpl_hist_quantile(_h, 0.999);
+  q[3] = xpl_hist_quantile(_h, 1.0);
+  mean = _h->count > 0 ? (double)_h->sum / _h->count : 0.0;
+  if(_j) {
+    fputs("{\"name\":\"", _f);
+    for(c = _n; *c; c++) {
+      if(*c == '"' || *c == '\\') fprintf(_f, "\\%c", *c);
+      else if((unsigned char)*c < 0x20) fprintf(_f, "\\u%04x", (unsigned char)*c);
+      else fputc(*c, _f);
+    }
+    fprintf(_f, "\",\"runs\":%lld,\"yields\":%lld,\"errors\":%lld,\"mean_ns\":%.0f,"
+      "\"p50_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld}\n",
+      (long long)_h->count, (long long)_h->yields, (long long)_h->errors, mean, q[0], q[1], q[2], q[3]);
+  } else {
+    fprintf(_f, "%s: runs %lld, yields %lld, errors %lld, mean %.2fus, p50 %.2fus, p99 %.2fus, p99.9 %.2fus, max %.2fus\n",
+      _n, (long long)_h->count, (long long)_h->yields, (long long)_h->errors,
+      mean / 1e3, q[0] / 1e3, q[1] / 1e3, q[2] / 1e3, q[3] / 1e3);
+  }
 
-  return ret;
+  return XS_OK;
 }
+#endif /* XPL_HISTOGRAM */
 
 XPLAPI xpl_status_t xpl_peek_func(xpl_context_t* _s, xpl_func_info_t** _f) {
   xpl_status_t ret = XS_OK;
@@ -578,10 +2852,11 @@ XPLAPI xpl_status_t xpl_peek_func(xpl_context_t* _s, xpl_func_info_t** _f) {
   xpl_assert(_s && _s->text);
   XPL_SKIP_MEANINGLESS(_s);
   if(_f) *_f = NULL;
+  if(*_s->cursor == '\0') return ret;
   if(_xpl_is_comma(*(unsigned char*)_s->cursor)) {
     _s->cursor++;
   } else {
-    func = (xpl_func_info_t*)bsearch(_s->cursor, _s->funcs, _s->funcs_count, sizeof(xpl_func_info_t), _xpl_func_info_sch_cmp);
+    func = xpl_find_func(_s, _s->cursor);
     if(!func) return XS_ERR;
     if(_f) *_f = func;
   }
@@ -593,8 +2868,10 @@ XPLAPI xpl_status_t xpl_step(xpl_context_t* _s) {
   xpl_status_t ret = XS_OK;
   xpl_func_info_t* func = NULL;
   xpl_assert(_s && _s->text);
+  if(_s->program && _s->program->validated) return _xpl_step_validated(_s);
   if((ret = xpl_peek_func(_s, &func)) != XS_OK) return ret;
   if(!func) return ret;
+  _s->statement = _s->cursor;
   _s->cursor += strlen(func->name);
   XPL_SKIP_MEANINGLESS(_s);
   if((ret = func->func(_s)) != XS_OK) return ret;
@@ -602,12 +2879,34 @@ XPLAPI xpl_status_t xpl_step(xpl_context_t* _s) {
   return ret;
 }
 
+XPLAPI xpl_status_t xpl_call(xpl_context_t* _s, xpl_func_t _f, const char* _p) {
+  xpl_status_t ret = XS_OK;
+  const char* text = NULL;
+  const char* cursor = NULL;
+  const char* statement = NULL;
+  xpl_assert(_s && _f && _p);
+  text = _s->text; cursor = _s->cursor; statement = _s->statement;
+  _s->statement = _s->cursor = _s->text = _p;
+  if((ret = _f(_s)) == XS_OK) {
+    XPL_SKIP_MEANINGLESS(_s);
+    while(_xpl_is_comma(*(unsigned char*)_s->cursor)) {
+      _s->cursor++;
+      XPL_SKIP_MEANINGLESS(_s);
+    }
+    if(*_s->cursor) ret = XS_ERR;
+  }
+  _s->text = text; _s->cursor = cursor; _s->statement = statement;
+
+  return ret;
+}
+
 XPLAPI xpl_status_t xpl_skip_comment(xpl_context_t* _s) {
   xpl_assert(_s && _s->text);
   if(_xpl_is_squote(*(unsigned char*)_s->cursor)) {
     do {
       _s->cursor++;
     } while(*(unsigned char*)_s->cursor != '\0' && !_xpl_is_squote(*(unsigned char*)_s->cursor));
+    if(*_s->cursor == '\0') return XS_SYNTAX_ERROR;
     _s->cursor++;
 
     return XS_OK;
@@ -620,23 +2919,40 @@ XPLAPI xpl_status_t xpl_has_param(xpl_context_t* _s) {
   xpl_func_info_t* func = NULL;
   xpl_assert(_s && _s->text);
   XPL_SKIP_MEANINGLESS(_s);
-  if(_s->cursor[0] == '\0') return XS_NO_PARAM;
+  if(_s->cursor[0] == '\0' || _xpl_is_comma(*(unsigned char*)_s->cursor)) return XS_NO_PARAM;
   xpl_peek_func(_s, &func);
 
-  return ((_xpl_is_comma(*(unsigned char*)_s->cursor) || func) ? XS_NO_PARAM : XS_OK);
+  return func ? XS_NO_PARAM : XS_OK;
 }
 
 XPLAPI xpl_status_t xpl_skip_string(xpl_context_t* _s) {
   const char* src = NULL;
+  char esc[16];
+  char* dst = NULL;
   xpl_assert(_s && _s->text);
   src = _s->cursor;
   if(_xpl_is_dquote(*(unsigned char*)src)) {
     src++;
-    while(!_xpl_is_dquote(*(unsigned char*)src))
-      src++;
+    while(!_xpl_is_dquote(*(unsigned char*)src)) {
+      if(*src == '\0') {
+        _s->cursor = src;
+
+        return XS_SYNTAX_ERROR;
+      } else if(_s->config->escape_detect && (*_s->config->escape_detect)(*(unsigned char*)src)) {
+        xpl_assert(_s->config->escape_parse);
+        dst = esc;
+        if(!(*_s->config->escape_parse)(&dst, &src)) {
+          _s->cursor = src;
+
+          return XS_BAD_ESCAPE_FORMAT;
+        }
+      } else {
+        src++;
+      }
+    }
     src++;
   } else {
-    while(!_xpl_is_separator(*(unsigned char*)src, _s->separator_detect) && *src != '\0')
+    while(!_xpl_is_separator(*(unsigned char*)src, _s->config->separator_detect) && *src != '\0')
       src++;
   }
   _s->cursor = src;
@@ -670,6 +2986,8 @@ XPLAPI xpl_status_t xpl_pop_double(xpl_context_t* _s, double* _o) {
 
 XPLAPI xpl_status_t xpl_pop_string(xpl_context_t* _s, char* _o, int _l) {
   const char* src = NULL;
+  char esc[16];
+  char* e = NULL;
   char* dst = NULL;
   xpl_assert(_s && _s->text && _o);
   src = _s->cursor;
@@ -677,29 +2995,52 @@ XPLAPI xpl_status_t xpl_pop_string(xpl_context_t* _s, char* _o, int _l) {
   if(_xpl_is_dquote(*(unsigned char*)src)) {
     src++;
     while(!_xpl_is_dquote(*(unsigned char*)src)) {
-      if(_s->escape_detect && (*_s->escape_detect)(*(unsigned char*)src)) {
-        xpl_assert(_s->escape_parse);
-        if(!(*_s->escape_parse)(&dst, &src))
+      if(*src == '\0') {
+        return XS_SYNTAX_ERROR;
+      } else if(_s->config->escape_detect && (*_s->config->escape_detect)(*(unsigned char*)src)) {
+        xpl_assert(_s->config->escape_parse);
+        /* Decodes aside first, never writes past the buffer. */
+        e = esc;
+        if(!(*_s->config->escape_parse)(&e, &src))
           return XS_BAD_ESCAPE_FORMAT;
+        if(dst + (e - esc) + 1 - _o > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
+        memcpy(dst, esc, e - esc);
+        dst += e - esc;
       } else {
+        if(dst + 2 - _o > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
         *dst++ = *src++;
       }
-      if(dst + 1 - _o > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
     }
     src++;
   } else {
-    while(!_xpl_is_separator(*(unsigned char*)src, _s->separator_detect) && *src != '\0') {
+    while(!_xpl_is_separator(*(unsigned char*)src, _s->config->separator_detect) && *src != '\0') {
+      if(dst + 2 - _o > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
       *dst++ = *src++;
-      if(dst + 1 - _o > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
     }
   }
-  _s->cursor = src;
   if(dst + 1 - _o > _l) return XS_NO_ENOUGH_BUFFER_SIZE;
+  _s->cursor = src;
   *dst++ = '\0';
 
   return XS_OK;
 }
 
+XPLAPI xpl_status_t xpl_pop_arena_string(xpl_context_t* _s, const char** _o, int* _l) {
+  xpl_arena_t* a = NULL;
+  xpl_status_t ret = XS_OK;
+  xpl_assert(_s && _s->locals && _s->locals->arena && _o);
+  a = _s->locals->arena;
+  ret = xpl_pop_string(_s, a->buffer + a->used, a->size - a->used);
+  if(ret == XS_NO_ENOUGH_BUFFER_SIZE) return XS_ARENA_FULL;
+  if(ret != XS_OK) return ret;
+  *_o = a->buffer + a->used;
+  if(_l) *_l = (int)strlen(*_o);
+  a->used += (int)strlen(*_o) + 1;
+  if(a->used > a->peak) a->peak = a->used;
+
+  return XS_OK;
+}
+
 XPLAPI xpl_status_t xpl_push_bool(xpl_context_t* _s, int _b) {
   xpl_assert(_s && _s->text);
   switch(_s->bool_composing) {
@@ -712,68 +3053,81 @@ XPLAPI xpl_status_t xpl_push_bool(xpl_context_t* _s, int _b) {
   return XS_OK;
 }
 
+XPLAPI xpl_status_t xpl_pop_bool(xpl_context_t* _s, int* _o) {
+  xpl_assert(_s && _o);
+  *_o = _s->bool_value;
+  _s->bool_value = 0;
+  _s->bool_composing = XBC_NIL;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_set_reg(xpl_context_t* _s, int _i, long _v) {
+  xpl_assert(_s);
+  if(_i < 0 || _i >= XPL_REG_COUNT) return XS_BAD_REGISTER_INDEX;
+  if(!_s->locals) return XS_NO_LOCALS;
+  _s->locals->regs[_i] = _v;
+
+  return XS_OK;
+}
+
+XPLAPI xpl_status_t xpl_get_reg(xpl_context_t* _s, int _i, long* _o) {
+  xpl_assert(_s && _o);
+  if(_i < 0 || _i >= XPL_REG_COUNT) return XS_BAD_REGISTER_INDEX;
+  if(!_s->locals) return XS_NO_LOCALS;
+  *_o = _s->locals->regs[_i];
+
+  return XS_OK;
+}
+
 XPLINTERNAL xpl_status_t _xpl_core_if(xpl_context_t* _s) {
+  const xpl_jump_t* j = NULL;
   xpl_assert(_s && _s->text);
   _s->if_statement_depth++;
+  if((j = _xpl_find_jump(_s)) != NULL) _s->cursor = _s->text + j->target;
 
   return XS_OK;
 }
 
 XPLINTERNAL xpl_status_t _xpl_core_then(xpl_context_t* _s) {
-  xpl_status_t ret = XS_OK;
   xpl_func_info_t* func = NULL;
+  const xpl_jump_t* j = NULL;
+  int b = 0;
   xpl_assert(_s && _s->text);
-  if(_s->bool_value) {
-    _s->bool_value = 0;
-    _s->bool_composing = XBC_NIL;
-    do {
-      if((ret = xpl_peek_func(_s, &func)) != XS_OK) return ret;
-      if(!func) continue;
-      if(func->func == _xpl_core_elseif || func->func == _xpl_core_else) break;
-      else if(func->func == _xpl_core_endif) { _s->if_statement_depth--; break; }
-      _s->cursor += strlen(func->name);
-      XPL_SKIP_MEANINGLESS(_s);
-      if((ret = func->func(_s)) != XS_OK) return ret;
-    } while(*_s->cursor);
-    do {
-      if((ret = xpl_peek_func(_s, &func)) != XS_OK) return ret;
-      if(!func) continue;
-      _s->cursor += strlen(func->name);
-      if(func->func == _xpl_core_endif) { _s->if_statement_depth--; break; }
-    } while(*_s->cursor);
-  } else {
-    _s->bool_value = 0;
-    _s->bool_composing = XBC_NIL;
-    do {
-      _xpl_skip_ifcond_body(_s);
-      xpl_peek_func(_s, &func);
-      if(!func) continue;
-      if(func->func == _xpl_core_elseif || func->func == _xpl_core_else) break;
-      else if(func->func == _xpl_core_endif) { _s->if_statement_depth--; break; }
-      _s->cursor += strlen(func->name);
-    } while(*_s->cursor);
+  xpl_pop_bool(_s, &b);
+  if(b) return XS_OK;
+  if((j = _xpl_find_jump(_s)) != NULL) _s->cursor = _s->text + j->target;
+  else _xpl_skip_ifcond_body(_s);
+  xpl_peek_func(_s, &func);
+  if(func) {
+    _s->cursor += strlen(func->name);
+    if(func->func == _xpl_core_endif) _s->if_statement_depth--;
   }
 
-  return ret;
+  return XS_OK;
 }
 
 XPLINTERNAL xpl_status_t _xpl_core_elseif(xpl_context_t* _s) {
+  const xpl_jump_t* j = NULL;
   xpl_assert(_s && _s->text);
-  XPL_DO_NOTHING(_s);
+  if((j = _xpl_find_jump(_s)) != NULL) _s->cursor = _s->text + j->target;
+  else _xpl_leave_ifcond(_s);
 
   return XS_OK;
 }
 
 XPLINTERNAL xpl_status_t _xpl_core_else(xpl_context_t* _s) {
+  const xpl_jump_t* j = NULL;
   xpl_assert(_s && _s->text);
-  XPL_DO_NOTHING(_s);
+  if((j = _xpl_find_jump(_s)) != NULL) _s->cursor = _s->text + j->target;
+  else _xpl_leave_ifcond(_s);
 
   return XS_OK;
 }
 
 XPLINTERNAL xpl_status_t _xpl_core_endif(xpl_context_t* _s) {
   xpl_assert(_s && _s->text);
-  XPL_DO_NOTHING(_s);
+  if(_s->if_statement_depth > 0) _s->if_statement_depth--;
 
   return XS_OK;
 }
@@ -798,17 +3152,138 @@ XPLINTERNAL xpl_status_t _xpl_core_yield(xpl_context_t* _s) {
   return XS_SUSPENT;
 }
 
+XPLINTERNAL xpl_status_t _xpl_core_store(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  long idx = 0;
+  long val = 0;
+  xpl_assert(_s && _s->text);
+  if((ret = xpl_has_param(_s)) != XS_OK) return ret;
+  if((ret = xpl_pop_long(_s, &idx)) != XS_OK) return ret;
+  if(idx < 0 || idx >= XPL_REG_COUNT) return XS_BAD_REGISTER_INDEX;
+  val = _s->bool_value;
+  if(xpl_has_param(_s) == XS_OK && (ret = xpl_pop_long(_s, &val)) != XS_OK) return ret;
+
+  return xpl_set_reg(_s, (int)idx, val);
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_load(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  long idx = 0;
+  long val = 0;
+  xpl_assert(_s && _s->text);
+  if((ret = xpl_has_param(_s)) != XS_OK) return ret;
+  if((ret = xpl_pop_long(_s, &idx)) != XS_OK) return ret;
+  if(idx < 0 || idx >= XPL_REG_COUNT) return XS_BAD_REGISTER_INDEX;
+  if((ret = xpl_get_reg(_s, (int)idx, &val)) != XS_OK) return ret;
+
+  return xpl_push_bool(_s, val != 0);
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_switch(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  const xpl_program_t* p = NULL;
+  const xpl_case_t* c = NULL;
+  long idx = 0;
+  long label = 0;
+  int pos = 0;
+  int i = 0;
+  xpl_assert(_s && _s->text);
+  if(!(p = _s->program)) return XS_NO_PROGRAM;
+  if((ret = xpl_has_param(_s)) != XS_OK) return ret;
+  if((ret = xpl_pop_long(_s, &idx)) != XS_OK) return ret;
+  if(idx < 0 || idx >= XPL_REG_COUNT) return XS_BAD_REGISTER_INDEX;
+  if((ret = xpl_get_reg(_s, (int)idx, &label)) != XS_OK) return ret;
+  pos = (int)(_s->statement - _s->text);
+  for(i = XPL_CASE_HASH(pos, label); p->case_slots[i]; i = (i + 1) % XPL_CASE_SLOTS) {
+    c = &p->cases[p->case_slots[i] - 1];
+    if(c->pos == pos && c->label == label) {
+      _s->cursor = _s->text + c->target;
+
+      return XS_OK;
+    }
+  }
+
+  return _xpl_jump(_s);
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_case(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+
+  return _xpl_jump(_s);
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_default(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+
+  return _xpl_jump(_s);
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_endswitch(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+  XPL_DO_NOTHING(_s);
+
+  return XS_OK;
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_while(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+  XPL_DO_NOTHING(_s);
+
+  return XS_OK;
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_do(xpl_context_t* _s) {
+  int b = 0;
+  xpl_assert(_s && _s->text);
+  xpl_pop_bool(_s, &b);
+
+  return b ? XS_OK : _xpl_jump(_s);
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_endwhile(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+
+  return _xpl_jump(_s);
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_repeat(xpl_context_t* _s) {
+  xpl_status_t ret = XS_OK;
+  long n = 0;
+  xpl_assert(_s && _s->text);
+  if(!_s->program) return XS_NO_PROGRAM;
+  if((ret = xpl_has_param(_s)) != XS_OK) return ret;
+  if((ret = xpl_pop_long(_s, &n)) != XS_OK) return ret;
+  if(n <= 0) return _xpl_jump(_s);
+  if(!_s->locals) return XS_NO_LOCALS;
+  if(_s->loop_depth == XPL_LOOP_DEPTH) return XS_ERR;
+  _s->locals->loop_counters[_s->loop_depth++] = n;
+
+  return XS_OK;
+}
+
+XPLINTERNAL xpl_status_t _xpl_core_endrepeat(xpl_context_t* _s) {
+  xpl_assert(_s && _s->text);
+  if(!_s->loop_depth || !_s->locals) return XS_ERR;
+  if(--_s->locals->loop_counters[_s->loop_depth - 1] > 0) return _xpl_jump(_s);
+  _s->loop_depth--;
+
+  return XS_OK;
+}
+
 void _xpl_skip_ifcond_body(xpl_context_t* _s) {
   xpl_func_info_t* func = NULL;
+  const char* prev = NULL;
   int lv = _s->if_statement_depth;
   xpl_assert(_s && _s->text);
   do {
+    XPL_SKIP_MEANINGLESS(_s);
+    if(_xpl_is_comma(*(unsigned char*)_s->cursor)) { _s->cursor++; continue; }
+    func = NULL;
     xpl_peek_func(_s, &func);
     if(!func) {
-      XPL_SKIP_MEANINGLESS(_s);
-      _s->cursor++;
-      while(!_xpl_is_separator(*(unsigned char*)(_s->cursor), _s->separator_detect))
-        _s->cursor++;
+      prev = _s->cursor;
+      xpl_skip_string(_s);
+      if(_s->cursor == prev && *_s->cursor) _s->cursor++;
       continue;
     } else if(func->func == _xpl_core_if) {
       _s->if_statement_depth++;
@@ -820,6 +3295,141 @@ void _xpl_skip_ifcond_body(xpl_context_t* _s) {
   } while(*_s->cursor);
 }
 
+XPLINTERNAL void _xpl_leave_ifcond(xpl_context_t* _s) {
+  xpl_func_info_t* func = NULL;
+  xpl_assert(_s && _s->text);
+  do {
+    _xpl_skip_ifcond_body(_s);
+    func = NULL;
+    xpl_peek_func(_s, &func);
+    if(!func) return;
+    _s->cursor += strlen(func->name);
+  } while(func->func != _xpl_core_endif);
+  _s->if_statement_depth--;
+}
+
+XPLINTERNAL xpl_status_t _xpl_jump(xpl_context_t* _s) {
+  const xpl_jump_t* j = NULL;
+  xpl_assert(_s && _s->text);
+  if(!_s->program) return XS_NO_PROGRAM;
+  j = _xpl_find_jump(_s);
+  if(!j) return XS_ERR;
+  _s->cursor = _s->text + j->target;
+
+  return XS_OK;
+}
+
+XPLINTERNAL const xpl_jump_t* _xpl_find_jump(xpl_context_t* _s) {
+  xpl_jump_t key;
+  xpl_assert(_s && _s->text);
+  if(!_s->program) return NULL;
+  key.pos = (int)(_s->statement - _s->text);
+
+  return (const xpl_jump_t*)bsearch(&key, _s->program->jumps, _s->program->jumps_count, sizeof(xpl_jump_t), _xpl_jump_cmp);
+}
+
+XPLINTERNAL int _xpl_fold_cond(xpl_context_t* _s) {
+  xpl_func_info_t* func = NULL;
+  const char* cursor = NULL;
+  int consts = 0;
+  int b = 0;
+  int ret = -1;
+  xpl_assert(_s && _s->text && !_s->program);
+  cursor = _s->cursor;
+  _s->bool_composing = XBC_NIL;
+  _s->bool_value = 0;
+  for(;;) {
+    if(xpl_peek_func(_s, &func) != XS_OK || !func) break;
+    if(func->func == _xpl_core_then) {
+      if(consts) {
+        xpl_pop_bool(_s, &b);
+        ret = !!b;
+      }
+      break;
+    }
+    if(!func->constant && func->func != _xpl_core_or && func->func != _xpl_core_and) break;
+    if(func->constant) consts++;
+    if(xpl_step(_s) != XS_OK) break;
+  }
+  _s->cursor = cursor;
+
+  return ret;
+}
+
+XPLINTERNAL xpl_status_t _xpl_step_validated(xpl_context_t* _s) {
+  const xpl_program_t* p = _s->program;
+  const xpl_stmt_t* st = NULL;
+  xpl_func_info_t* func = NULL;
+  xpl_stmt_t key;
+  int n = _s->stmt;
+  int at = (int)(_s->cursor - _s->text);
+  /* Validating checked the text between the parameters of a statement and
+     the next one to be meaningless, a cursor in between runs on to the next
+     statement. Otherwise it jumped or left parameters, re-syncs then. */
+  if(n > 0 && n < p->stmts_count && at >= p->stmts[n - 1].end && at <= p->stmts[n].pos) {
+    st = &p->stmts[n];
+  } else {
+    XPL_SKIP_MEANINGLESS(_s);
+    if(*_s->cursor == '\0') return XS_OK;
+    if(_xpl_is_comma(*(unsigned char*)_s->cursor)) { _s->cursor++; return XS_OK; }
+    key.pos = (int)(_s->cursor - _s->text);
+    st = (const xpl_stmt_t*)bsearch(&key, p->stmts, p->stmts_count, sizeof(xpl_stmt_t), _xpl_stmt_cmp);
+    if(!st) return XS_ERR;
+  }
+  _s->stmt = (int)(st - p->stmts) + 1;
+  _s->statement = _s->text + st->pos;
+  _s->cursor = _s->text + st->next;
+  if(st->func < 0) {
+    if(!(func = xpl_find_func(_s, _s->statement))) return XS_ERR;
+
+    return func->func(_s);
+  }
+
+  return _s->config->funcs[st->func].func(_s);
+}
+
+XPLINTERNAL void _xpl_merge(void* _a, int _n, int _k, size_t _z, int (* _cmp)(const void*, const void*)) {
+  char* a = (char*)_a;
+  int l = 0;
+  int h = 0;
+  int m = 0;
+  xpl_assert(_a && _k >= 0 && _k <= _n && _cmp);
+  if(!_k) return;
+  qsort(a + (_n - _k) * _z, _k, _z, _cmp);
+  /* Rotates the appended slice into place, edits are local so all its
+     entries land at the same spot. */
+  l = 0; h = _n - _k;
+  while(l < h) {
+    m = (l + h) / 2;
+    if(_cmp(a + m * _z, a + (_n - _k) * _z) < 0) l = m + 1;
+    else h = m;
+  }
+  _xpl_reverse(a + l * _z, _n - _k - l, _z);
+  _xpl_reverse(a + (_n - _k) * _z, _k, _z);
+  _xpl_reverse(a + l * _z, _n - l, _z);
+}
+
+XPLINTERNAL void _xpl_reverse(char* _a, int _n, size_t _z) {
+  char* l = _a;
+  char* r = _a + (_n - 1) * _z;
+  char t = '\0';
+  size_t i = 0;
+  if(_n < 2) return;
+  for(; l < r; l += _z, r -= _z) {
+    for(i = 0; i < _z; i++) { t = l[i]; l[i] = r[i]; r[i] = t; }
+  }
+}
+
+XPLINTERNAL xpl_status_t _xpl_add_jump(xpl_program_t* _p, int _pos) {
+  xpl_assert(_p);
+  if(_p->jumps_count == XPL_JUMP_COUNT) return XS_PROGRAM_TOO_LARGE;
+  _p->jumps[_p->jumps_count].pos = _pos;
+  _p->jumps[_p->jumps_count].target = -1;
+  _p->jumps_count++;
+
+  return XS_OK;
+}
+
 XPLINTERNAL int _xpl_is_squote(unsigned char _c) {
   return _c == '\'';
 }
@@ -832,6 +3442,17 @@ XPLINTERNAL int _xpl_is_comma(unsigned char _c) {
   return _c == ',';
 }
 
+XPLINTERNAL int _xpl_is_number(const char* _b, const char* _e) {
+  if(_b < _e && (*_b == '-' || *_b == '+')) _b++;
+  if(_b < _e && *_b == '.') _b++;
+  if(_b == _e || *_b < '0' || *_b > '9') return 0;
+  for(; _b < _e; _b++) {
+    if(!isxdigit(*(unsigned char*)_b) && !strchr("xX.-+", *_b)) return 0;
+  }
+
+  return 1;
+}
+
 XPLINTERNAL int _xpl_is_exclamation(unsigned char _c) {
   return _c == '!';
 }
@@ -889,6 +3510,221 @@ XPLINTERNAL int _xpl_func_info_sch_cmp(const void* _k, const void* _i) {
   return _xpl_strcmp(k, i->name);
 }
 
+XPLINTERNAL int _xpl_jump_cmp(const void* _l, const void* _r) {
+  const xpl_jump_t* l = (const xpl_jump_t*)_l;
+  const xpl_jump_t* r = (const xpl_jump_t*)_r;
+  xpl_assert(l && r);
+
+  return (l->pos > r->pos) - (l->pos < r->pos);
+}
+
+XPLINTERNAL int _xpl_registry_find(const xpl_registry_t* _r, const char* _k) {
+  const xpl_registry_node_t* node = NULL;
+  int cur = 0;
+  int c = 0;
+  xpl_assert(_r && _k);
+  if(!_r->nodes_count) return -1;
+  c = _xpl_is_separator(*(unsigned char*)_k, NULL) ? '\0' : *(unsigned char*)_k;
+  while(c) {
+    node = &_r->nodes[cur];
+    if(c < node->ch) {
+      cur = node->lo;
+    } else if(c > node->ch) {
+      cur = node->hi;
+    } else {
+      _k++;
+      c = _xpl_is_separator(*(unsigned char*)_k, NULL) ? '\0' : *(unsigned char*)_k;
+      if(!c) return cur;
+      cur = node->eq;
+    }
+    if(!cur) break;
+  }
+
+  return -1;
+}
+
+XPLINTERNAL void _xpl_registry_reclaim(xpl_registry_t* _r) {
+  xpl_registry_ring_t* g[2];
+  int i = 0;
+  int j = 0;
+  xpl_assert(_r);
+  g[0] = &_r->funcs_recycled;
+  g[1] = &_r->nodes_recycled;
+  for(i = 0; i < 2; i++) {
+    if(!g[0]->waiting && !g[1]->waiting) {
+      if(!g[0]->retired && !g[1]->retired) break;
+      for(j = 0; j < 2; j++) { g[j]->waiting = g[j]->retired; g[j]->retired = 0; }
+      xpl_barrier();
+      _r->phase = !_r->phase;
+      xpl_barrier();
+    }
+    /* Lookups of the previous grace period could still hold what was
+       unlinked before it ended. */
+    if(_r->readers[_r->phase ^ 1]) break;
+    for(j = 0; j < 2; j++) { g[j]->frees += g[j]->waiting; g[j]->waiting = 0; }
+  }
+}
+
+XPLINTERNAL int _xpl_registry_take(xpl_registry_ring_t* _g, const int* _a, int _n, int* _c) {
+  int ret = -1;
+  xpl_assert(_g && _a && _c);
+  if(_g->frees) {
+    ret = _a[_g->head];
+    _g->head = (_g->head + 1) % _n;
+    _g->frees--;
+  } else if(*_c < _n) {
+    ret = (*_c)++;
+  }
+
+  return ret;
+}
+
+XPLINTERNAL void _xpl_registry_retire(xpl_registry_ring_t* _g, int* _a, int _n, int _i) {
+  xpl_assert(_g && _a && _i >= 0 && _i < _n);
+  _a[(_g->head + _g->frees + _g->waiting + _g->retired) % _n] = _i;
+  _g->retired++;
+}
+
+#ifdef XPL_HISTOGRAM
+XPLINTERNAL int _xpl_hist_bucket(long long _ns) {
+  unsigned long long u = (unsigned long long)_ns;
+  int m = 0;
+  if(u < (1ull << XPL_HIST_SUB_BITS)) return (int)u;
+  while(u >> 8) { u >>= 8; m += 8; }
+  while(u >> 1) { u >>= 1; m++; }
+
+  return ((m - XPL_HIST_SUB_BITS + 1) << XPL_HIST_SUB_BITS) +
+    (int)(((unsigned long long)_ns >> (m - XPL_HIST_SUB_BITS)) - (1ull << XPL_HIST_SUB_BITS));
+}
+
+XPLINTERNAL long long _xpl_hist_value(int _i) {
+  int m = 0;
+  xpl_assert(_i >= 0 && _i < XPL_HIST_BUCKETS);
+  if(_i < (1 << XPL_HIST_SUB_BITS)) return _i;
+  m = (_i >> XPL_HIST_SUB_BITS) + XPL_HIST_SUB_BITS - 1;
+
+  return (long long)((((unsigned long long)(1 << XPL_HIST_SUB_BITS) + (_i & ((1 << XPL_HIST_SUB_BITS) - 1)) + 1) << (m - XPL_HIST_SUB_BITS)) - 1);
+}
+
+XPLINTERNAL long long _xpl_hist_clock(void) {
+#if defined CLOCK_MONOTONIC
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#else /* CLOCK_MONOTONIC */
+  /* The Microsoft CRT counts wall time since the process started. */
+  return (long long)((double)clock() * 1e9 / CLOCKS_PER_SEC);
+#endif /* CLOCK_MONOTONIC */
+}
+#endif /* XPL_HISTOGRAM */
+
+XPLINTERNAL unsigned int _xpl_funcs_hash(const xpl_config_t* _c) {
+  unsigned int ret = 2166136261u;
+  int i = 0;
+  xpl_assert(_c);
+  for(i = 0; i < _c->funcs_count; i++) {
+    ret ^= _xpl_hash(_c->funcs[i].name);
+    ret *= 16777619u;
+    ret ^= (unsigned int)!!_c->funcs[i].constant;
+    ret *= 16777619u;
+  }
+
+  return ret & 0xffffffffu;
+}
+
+XPLINTERNAL int _xpl_store_find(const xpl_store_t* _t, const char* _n, int* _i) {
+  const char* base = (const char*)_t;
+  int l = 0;
+  int h = 0;
+  int m = 0;
+  int c = 0;
+  xpl_assert(_t && _n && _i);
+  h = _t->count;
+  while(l < h) {
+    m = (l + h) / 2;
+    if(!(c = strcmp(base + _t->entries[m].name, _n))) { *_i = m; return 1; }
+    if(c < 0) l = m + 1;
+    else h = m;
+  }
+  *_i = l;
+
+  return 0;
+}
+
+XPLINTERNAL unsigned int _xpl_hash(const char* _t) {
+  unsigned int ret = 2166136261u;
+  xpl_assert(_t);
+  while(*_t) {
+    ret ^= *(unsigned char*)_t++;
+    ret *= 16777619u;
+  }
+
+  return ret & 0xffffffffu;
+}
+
+XPLINTERNAL int _xpl_put_varint(unsigned char** _b, const unsigned char* _e, long _v) {
+  unsigned long u = ((unsigned long)_v << 1) ^ (unsigned long)(_v < 0 ? -1L : 0L);
+  xpl_assert(_b && *_b && _e);
+  do {
+    if(*_b == _e) return 0;
+    *(*_b)++ = (unsigned char)((u & 0x7f) | (u > 0x7f ? 0x80 : 0));
+    u >>= 7;
+  } while(u);
+
+  return 1;
+}
+
+XPLINTERNAL int _xpl_get_varint(const unsigned char** _b, const unsigned char* _e, long* _v) {
+  unsigned long u = 0;
+  int shift = 0;
+  xpl_assert(_b && *_b && _e && _v);
+  do {
+    if(*_b == _e || shift >= (int)sizeof(unsigned long) * 8) return 0;
+    u |= (unsigned long)(**_b & 0x7f) << shift;
+    shift += 7;
+  } while(*(*_b)++ & 0x80);
+  *_v = (long)(u >> 1) ^ -(long)(u & 1);
+
+  return 1;
+}
+
+XPLINTERNAL int _xpl_stmt_cmp(const void* _l, const void* _r) {
+  const xpl_stmt_t* l = (const xpl_stmt_t*)_l;
+  const xpl_stmt_t* r = (const xpl_stmt_t*)_r;
+  xpl_assert(l && r);
+
+  return (l->pos > r->pos) - (l->pos < r->pos);
+}
+
+XPLINTERNAL int _xpl_span_cmp(const void* _l, const void* _r) {
+  const xpl_span_t* l = (const xpl_span_t*)_l;
+  const xpl_span_t* r = (const xpl_span_t*)_r;
+  xpl_assert(l && r);
+
+  return (l->begin > r->begin) - (l->begin < r->begin);
+}
+
+XPLINTERNAL int _xpl_case_cmp(const void* _l, const void* _r) {
+  const xpl_case_t* l = (const xpl_case_t*)_l;
+  const xpl_case_t* r = (const xpl_case_t*)_r;
+  xpl_assert(l && r);
+  if(l->pos != r->pos) return (l->pos > r->pos) - (l->pos < r->pos);
+
+  return (l->label > r->label) - (l->label < r->label);
+}
+
+XPLINTERNAL void _xpl_hash_cases(xpl_program_t* _p) {
+  int i = 0;
+  int j = 0;
+  xpl_assert(_p && _p->cases_count <= XPL_CASE_COUNT);
+  memset(_p->case_slots, 0, sizeof(_p->case_slots));
+  for(i = 0; i < _p->cases_count; i++) {
+    for(j = XPL_CASE_HASH(_p->cases[i].pos, _p->cases[i].label); _p->case_slots[j]; j = (j + 1) % XPL_CASE_SLOTS) {}
+    _p->case_slots[j] = (short)(i + 1);
+  }
+}
+
 /* ========================================================} */
 
 #ifdef __cplusplus
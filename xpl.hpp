@@ -0,0 +1,417 @@
+/**
+ * Compiling time front end of xpl.h, requires C++17 or above.
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://sam.zoy.org/wtfpl/COPYING for more details.
+ */
+
+#ifndef __XPL_HPP__
+#define __XPL_HPP__
+
+#include <cstddef>
+
+#include "xpl.h"
+
+/*
+** {========================================================
+** Compiling time front end
+**
+** Usage:
+**   static constexpr xpl_func_info_t my_funcs[] = { { "test1", test1 } };
+**   static constexpr auto funcs = xpl::make_funcs(my_funcs);
+**   static constexpr char text[] = "if cond1 then test1 3.14 endif";
+**   static constexpr xpl_program_t prog = xpl::compile(text, funcs);
+**   ...
+**   xpl::config_open(&cfg, funcs);
+**   xpl_open(&ctx, &cfg);
+**   xpl_load_program(&ctx, &prog);
+**   xpl_run(&ctx);
+**
+** Both the interface table and the prepared program are built while
+** compiling and could be placed in ROM. The program comes out validated as
+** xpl_validate would leave it, statements are resolved to their indexes in
+** the interface table. Unknown interface names, unbalanced blocks, missing
+** or unexpected parameters and bad 'case' labels are reported as compiling
+** errors. Parameters are checked more strictly than xpl_prepare does: a bare
+** word which is not an interface must be a number, other text must be
+** double quoted. Escapes are not checked, as escape functors are set at
+** runtime. Custom
+** separator functors are not supported at compiling time. Load time
+** constant interfaces can't be called while compiling, so their conditions
+** are not folded here, xpl_prepare them at runtime instead.
+*/
+
+namespace xpl {
+
+/**
+ * @brief Interface table built at compiling time, sorted and NULL
+ *  terminated as xpl_open requires.
+ */
+template<std::size_t N>
+struct func_table {
+  xpl_func_info_t items[N + 1]; /**< Sorted interfaces with a terminator. */
+};
+
+namespace detail {
+
+constexpr xpl_func_info_t core[] = { XPL_FUNC_CORE };
+
+constexpr std::size_t core_count = sizeof(core) / sizeof(*core);
+
+struct block_t {
+  xpl_func_t func;
+  int pos;
+  int jump;
+  int alt;
+  int start;
+  int body;
+};
+
+constexpr bool is_blank(char _c) {
+  return _c == ' ' || _c == '\t' || _c == '\r' || _c == '\n';
+}
+
+constexpr bool is_separator(char _c) {
+  return is_blank(_c) || _c == ',' || _c == ':' || _c == '\'' || _c == '"';
+}
+
+constexpr int strcmp(const char* _s, const char* _d) {
+  int ret = 0;
+  while(!(ret = (is_separator(*_s) ? '\0' : (unsigned char)*_s) - (unsigned char)*_d) && *_d) {
+    _s++; _d++;
+  }
+
+  return (ret > 0) - (ret < 0);
+}
+
+constexpr int strlen(const char* _s) {
+  int ret = 0;
+  while(_s[ret]) ret++;
+
+  return ret;
+}
+
+constexpr int skip_meaningless(const char* _t, int _i) {
+  while(is_blank(_t[_i]) || _t[_i] == '\'') {
+    if(_t[_i] == '\'') {
+      do {
+        if(!_t[++_i]) throw "xpl: unterminated comment";
+      } while(_t[_i] != '\'');
+    }
+    _i++;
+  }
+
+  return _i;
+}
+
+constexpr int skip_string(const char* _t, int _i) {
+  if(_t[_i] == '"') {
+    do {
+      if(!_t[++_i]) throw "xpl: unterminated string";
+    } while(_t[_i] != '"');
+
+    return _i + 1;
+  }
+  while(_t[_i] && !is_separator(_t[_i])) _i++;
+
+  return _i;
+}
+
+template<std::size_t N>
+constexpr const xpl_func_info_t* find(const func_table<N>& _f, const char* _k) {
+  for(std::size_t i = 0; i < N; i++) {
+    if(!strcmp(_k, _f.items[i].name)) return &_f.items[i];
+  }
+
+  return nullptr;
+}
+
+/* A bare word parameter must read as a number by strtod or strtol. */
+constexpr bool is_number(const char* _t, int _i) {
+  if(_t[_i] == '-' || _t[_i] == '+') _i++;
+  if(_t[_i] == '.') _i++;
+  if(_t[_i] < '0' || _t[_i] > '9') return false;
+  for(; _t[_i] && !is_separator(_t[_i]); _i++) {
+    char c = _t[_i];
+    if(!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F') ||
+      c == 'x' || c == 'X' || c == '.' || c == '-' || c == '+'))
+      return false;
+  }
+
+  return true;
+}
+
+constexpr int digit(char _c, int _b) {
+  int d = _b;
+  if(_c >= '0' && _c <= '9') d = _c - '0';
+  else if(_c >= 'a' && _c <= 'z') d = _c - 'a' + 10;
+  else if(_c >= 'A' && _c <= 'Z') d = _c - 'A' + 10;
+
+  return d < _b ? d : -1;
+}
+
+/* Parses a label the same way as strtol with base 0 does. */
+constexpr long parse_long(const char* _t, int _b, int _e) {
+  long ret = 0;
+  int base = 10;
+  bool neg = false;
+  if(_b < _e && (_t[_b] == '-' || _t[_b] == '+')) neg = _t[_b++] == '-';
+  if(_b + 1 < _e && _t[_b] == '0' && (_t[_b + 1] == 'x' || _t[_b + 1] == 'X')) { base = 16; _b += 2; }
+  else if(_b + 1 < _e && _t[_b] == '0') { base = 8; _b++; }
+  if(_b == _e) throw "xpl: bad 'case' label";
+  for(; _b < _e; _b++) {
+    if(digit(_t[_b], base) < 0) throw "xpl: bad 'case' label";
+    ret = ret * base + digit(_t[_b], base);
+  }
+
+  return neg ? -ret : ret;
+}
+
+constexpr int add_jump(xpl_program_t& _p, int _pos) {
+  if(_p.jumps_count == XPL_JUMP_COUNT) throw "xpl: too many jumps, enlarge XPL_JUMP_COUNT";
+  _p.jumps[_p.jumps_count].pos = _pos;
+  _p.jumps[_p.jumps_count].target = -1;
+
+  return _p.jumps_count++;
+}
+
+template<std::size_t N>
+constexpr int expect_param(const char* _t, int _i, const func_table<N>& _f) {
+  _i = skip_meaningless(_t, _i);
+  if(!_t[_i] || _t[_i] == ',' || (_t[_i] != '"' && find(_f, _t + _i)))
+    throw "xpl: parameter expected";
+
+  return _i;
+}
+
+}
+
+/**
+ * @brief Builds a sorted interface table with buildin interfaces at
+ *  compiling time, an alternative to XPL_FUNC_BEGIN/XPL_FUNC_ADD.
+ *
+ * @param[in] _f - Customized interfaces.
+ * @return - Returns the interface table.
+ */
+template<std::size_t N>
+constexpr func_table<detail::core_count + N> make_funcs(const xpl_func_info_t (&_f)[N]) {
+  func_table<detail::core_count + N> ret{};
+  std::size_t n = 0;
+  for(std::size_t i = 0; i < detail::core_count; i++) ret.items[n++] = detail::core[i];
+  for(std::size_t i = 0; i < N; i++) ret.items[n++] = _f[i];
+  for(std::size_t i = 1; i < n; i++) {
+    for(std::size_t j = i; j > 0 && detail::strcmp(ret.items[j - 1].name, ret.items[j].name) >= 0; j--) {
+      if(!detail::strcmp(ret.items[j - 1].name, ret.items[j].name)) throw "xpl: duplicate interface name";
+      xpl_func_info_t t = ret.items[j];
+      ret.items[j] = ret.items[j - 1];
+      ret.items[j - 1] = t;
+    }
+  }
+  ret.items[n] = xpl_func_info_t{ nullptr, nullptr, 0 };
+
+  return ret;
+}
+
+/**
+ * @brief Prepares a script at compiling time, produces the same program as
+ *  xpl_prepare does at runtime.
+ *
+ * @param[in] _t - Script source text, must have static storage duration.
+ * @param[in] _f - Interface table made by make_funcs.
+ * @return - Returns the prepared program.
+ */
+template<std::size_t N>
+constexpr xpl_program_t compile(const char* _t, const func_table<N>& _f) {
+  xpl_program_t p{};
+  detail::block_t blocks[XPL_BLOCK_DEPTH]{};
+  int depth = 0;
+  int begin = -1;
+  int need = 0;
+  int allow = 0;
+  int i = 0;
+  p.text = _t;
+  for(;;) {
+    /* Parameters are counted as xpl_validate does, 'case' and 'repeat'
+       consume their own. */
+    i = detail::skip_meaningless(_t, i);
+    if(!_t[i] || _t[i] == ',') {
+      if(need > 0) throw "xpl: parameter expected";
+      if(!_t[i]) break;
+      allow = 0;
+      i++;
+      continue;
+    }
+    const xpl_func_info_t* func = _t[i] == '"' ? nullptr : detail::find(_f, _t + i);
+    if(!func) {
+      if(_t[i] != '"' && !detail::is_number(_t, i)) throw "xpl: unknown interface name";
+      if(!allow) throw "xpl: unexpected parameter";
+      if(allow > 0) allow--;
+      if(need > 0) need--;
+      i = detail::skip_string(_t, i);
+      p.stmts[p.stmts_count - 1].end = i;
+      continue;
+    }
+    if(need > 0) throw "xpl: parameter expected";
+    if(p.stmts_count == XPL_STMT_COUNT) throw "xpl: too many statements, enlarge XPL_STMT_COUNT";
+    int pos = i;
+    i += detail::strlen(func->name);
+    p.stmts[p.stmts_count].pos = pos;
+    p.stmts[p.stmts_count].next = detail::skip_meaningless(_t, i);
+    p.stmts[p.stmts_count].func = (int)(func - _f.items);
+    p.stmts_count++;
+    need = allow = 0;
+    if(func->func == _xpl_core_store) { need = 1; allow = 2; }
+    else if(func->func == _xpl_core_load || func->func == _xpl_core_switch) need = allow = 1;
+    if(func->func == _xpl_core_if) {
+      if(depth == XPL_BLOCK_DEPTH) throw "xpl: blocks nested too deep, enlarge XPL_BLOCK_DEPTH";
+      detail::block_t& b = blocks[depth++];
+      b.func = func->func;
+      b.pos = pos;
+      b.jump = -1;
+      b.alt = -1;
+      b.start = p.jumps_count;
+      b.body = 0;
+    } else if(func->func == _xpl_core_then) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_if || blocks[depth - 1].body) throw "xpl: 'then' outside 'if'";
+      blocks[depth - 1].jump = detail::add_jump(p, pos);
+      blocks[depth - 1].body = 1;
+    } else if(func->func == _xpl_core_elseif || func->func == _xpl_core_else) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_if || blocks[depth - 1].body != 1) throw "xpl: 'elseif' or 'else' outside 'if'";
+      detail::block_t& b = blocks[depth - 1];
+      if(b.jump >= 0) p.jumps[b.jump].target = pos;
+      b.jump = -1;
+      b.body = func->func == _xpl_core_else ? 2 : 0;
+      detail::add_jump(p, pos);
+    } else if(func->func == _xpl_core_endif) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_if || !blocks[depth - 1].body) throw "xpl: unmatched 'endif'";
+      detail::block_t& b = blocks[--depth];
+      for(int j = b.start; j < p.jumps_count; j++) {
+        if(p.jumps[j].target < 0) p.jumps[j].target = pos;
+      }
+    } else if(func->func == _xpl_core_switch || func->func == _xpl_core_while || func->func == _xpl_core_repeat) {
+      if(depth == XPL_BLOCK_DEPTH) throw "xpl: blocks nested too deep, enlarge XPL_BLOCK_DEPTH";
+      detail::block_t& b = blocks[depth++];
+      b.func = func->func;
+      b.pos = pos;
+      b.jump = -1;
+      b.alt = -1;
+      b.body = func->func == _xpl_core_repeat;
+      if(func->func == _xpl_core_switch) {
+        b.jump = detail::add_jump(p, pos);
+      } else if(func->func == _xpl_core_repeat) {
+        int loops = 0;
+        for(int j = 0; j < depth; j++) loops += blocks[j].func == _xpl_core_repeat;
+        if(loops > XPL_LOOP_DEPTH) throw "xpl: 'repeat' nested too deep, enlarge XPL_LOOP_DEPTH";
+        i = detail::skip_string(_t, detail::expect_param(_t, i, _f));
+        b.jump = detail::add_jump(p, pos);
+        b.alt = i;
+      }
+    } else if(func->func == _xpl_core_case) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_switch) throw "xpl: 'case' outside 'switch'";
+      if(p.cases_count == XPL_CASE_COUNT) throw "xpl: too many 'case' labels, enlarge XPL_CASE_COUNT";
+      detail::add_jump(p, pos);
+      int b = detail::expect_param(_t, i, _f);
+      int q = _t[b] == '"';
+      i = detail::skip_string(_t, b);
+      p.cases[p.cases_count].pos = blocks[depth - 1].pos;
+      p.cases[p.cases_count].label = detail::parse_long(_t, b + q, i - q);
+      p.cases[p.cases_count].target = i;
+      p.cases_count++;
+      blocks[depth - 1].body = 1;
+    } else if(func->func == _xpl_core_default) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_switch) throw "xpl: 'default' outside 'switch'";
+      if(blocks[depth - 1].alt >= 0) throw "xpl: duplicate 'default'";
+      detail::add_jump(p, pos);
+      blocks[depth - 1].alt = i;
+      blocks[depth - 1].body = 1;
+    } else if(func->func == _xpl_core_endswitch) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_switch || !blocks[depth - 1].body) throw "xpl: unmatched 'endswitch'";
+      detail::block_t& b = blocks[--depth];
+      for(int j = b.jump + 1; j < p.jumps_count; j++) {
+        if(p.jumps[j].target < 0) p.jumps[j].target = i;
+      }
+      p.jumps[b.jump].target = b.alt >= 0 ? b.alt : i;
+    } else if(func->func == _xpl_core_do) {
+      if(!depth || blocks[depth - 1].func != _xpl_core_while || blocks[depth - 1].jump >= 0) throw "xpl: unmatched 'do'";
+      blocks[depth - 1].jump = detail::add_jump(p, pos);
+      blocks[depth - 1].body = 1;
+    } else if(func->func == _xpl_core_endwhile || func->func == _xpl_core_endrepeat) {
+      xpl_func_t open = func->func == _xpl_core_endwhile ? _xpl_core_while : _xpl_core_repeat;
+      if(!depth || blocks[depth - 1].func != open || blocks[depth - 1].jump < 0) throw "xpl: unmatched loop end";
+      detail::block_t& b = blocks[--depth];
+      int j = detail::add_jump(p, pos);
+      p.jumps[j].target = open == _xpl_core_while ? b.pos : b.alt;
+      p.jumps[b.jump].target = i;
+    } else if(depth && blocks[depth - 1].func == _xpl_core_switch && !blocks[depth - 1].body) {
+      throw "xpl: statement before the first 'case' or 'default'";
+    } else if(func->func != _xpl_core_or && func->func != _xpl_core_and && func->func != _xpl_core_yield &&
+      func->func != _xpl_core_store && func->func != _xpl_core_load) {
+      allow = -1;
+    }
+    p.stmts[p.stmts_count - 1].end = i;
+    if(depth && begin < 0) {
+      begin = pos;
+    } else if(!depth && begin >= 0) {
+      if(p.spans_count == XPL_SPAN_COUNT) throw "xpl: too many top level blocks, enlarge XPL_SPAN_COUNT";
+      p.spans[p.spans_count].begin = begin;
+      p.spans[p.spans_count].end = i;
+      p.spans_count++;
+      begin = -1;
+    }
+  }
+  if(depth) throw "xpl: unclosed block";
+  p.validated = 1;
+  for(int j = 1; j < p.jumps_count; j++) {
+    for(int k = j; k > 0 && p.jumps[k - 1].pos > p.jumps[k].pos; k--) {
+      xpl_jump_t t = p.jumps[k];
+      p.jumps[k] = p.jumps[k - 1];
+      p.jumps[k - 1] = t;
+    }
+  }
+  for(int j = 1; j < p.cases_count; j++) {
+    for(int k = j; k > 0; k--) {
+      const xpl_case_t& l = p.cases[k - 1];
+      const xpl_case_t& r = p.cases[k];
+      if(l.pos == r.pos && l.label == r.label) throw "xpl: duplicate 'case' label";
+      if(l.pos < r.pos || (l.pos == r.pos && l.label < r.label)) break;
+      xpl_case_t t = p.cases[k];
+      p.cases[k] = p.cases[k - 1];
+      p.cases[k - 1] = t;
+    }
+  }
+  for(int j = 0; j < p.cases_count; j++) {
+    int k = XPL_CASE_HASH(p.cases[j].pos, p.cases[j].label);
+    while(p.case_slots[k]) k = (k + 1) % XPL_CASE_SLOTS;
+    p.case_slots[k] = (short)(j + 1);
+  }
+
+  return p;
+}
+
+/**
+ * @brief Opens an XPL configuration with an interface table built at
+ *  compiling time, the table is used in place without sorting.
+ *
+ * @param[in] _c  - XPL configuration.
+ * @param[in] _f  - Interface table made by make_funcs.
+ * @param[in] _is - Separator determination functor.
+ * @return - Returns execution status.
+ */
+template<std::size_t N>
+inline xpl_status_t config_open(xpl_config_t* _c, const func_table<N>& _f, xpl_is_separator_func _is = nullptr) {
+  static xpl_func_info_t none[] = { { nullptr, nullptr, 0 } };
+  xpl_status_t ret = xpl_config_open(_c, none, _is);
+  _c->funcs = const_cast<xpl_func_info_t*>(_f.items);
+  _c->funcs_count = (int)N;
+
+  return ret;
+}
+
+}
+
+/* ========================================================} */
+
+#endif /* !__XPL_HPP__ */
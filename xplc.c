@@ -0,0 +1,335 @@
+/**
+ * xplc, ahead-of-time translator from XPL scripts to C source.
+ *
+ * Usage:
+ *   xplc [-f name[=symbol]]... [-p prefix] [-t table] [-o output] script...
+ *
+ *   -f name[=symbol] Declares a host interface, called through C symbol
+ *                    'symbol', which is 'name' by default.
+ *   -p prefix        Prefixes names of translated functions.
+ *   -t table         Also emits an interface array named 'table' which
+ *                    lists all translated scripts.
+ *   -o output        Writes to 'output' instead of stdout.
+ *
+ * Each script file becomes a function named after the file, with the
+ * signature of xpl_func_t. Include the output after the host interfaces
+ * are defined; a translated script runs as native branches and calls host
+ * interfaces through xpl_call with its literal parameters pre-bound, it
+ * could also be registered as an interface itself. 'yield' is not
+ * supported, keep scripts which suspend interpreted.
+ *
+ * This program is free software. It comes without any warranty, to
+ * the extent permitted by applicable law. You can redistribute it
+ * and/or modify it under the terms of the Do What The Fuck You Want
+ * To Public License, Version 2, as published by Sam Hocevar. See
+ * http://sam.zoy.org/wtfpl/COPYING for more details.
+ */
+
+#include "xpl.h"
+
+typedef struct xplc_stmt_t {
+  xpl_func_info_t* func; /**< Interface of the statement. */
+  int pos;               /**< Offset of the statement. */
+  const char* param;     /**< Beginning of parameter text. */
+  const char* param_end; /**< End of parameter text. */
+} xplc_stmt_t;
+
+typedef struct xplc_t {
+  const char** names;   /**< Host interface names. */
+  const char** symbols; /**< Host interface C symbols. */
+  int count;            /**< Count of host interfaces. */
+  const char* file;     /**< Script file being translated. */
+  xplc_stmt_t* stmts;   /**< Statements of the script. */
+  int stmts_count;      /**< Count of statements. */
+  FILE* out;            /**< Output stream. */
+} xplc_t;
+
+static xpl_status_t _xplc_host(xpl_context_t* _s) {
+  XPL_DO_NOTHING(_s);
+
+  return XS_OK;
+}
+
+static void _xplc_fail(xplc_t* _c, int _i, const char* _m) {
+  fprintf(stderr, "%s:%d: %s\n", _c->file, _i < _c->stmts_count ? _c->stmts[_i].pos : -1, _m);
+  exit(1);
+}
+
+static const char* _xplc_symbol(xplc_t* _c, xpl_func_info_t* _f) {
+  int i = 0;
+  if(_f->func == _xpl_core_or) return "_xpl_core_or";
+  if(_f->func == _xpl_core_and) return "_xpl_core_and";
+  if(_f->func == _xpl_core_store) return "_xpl_core_store";
+  if(_f->func == _xpl_core_load) return "_xpl_core_load";
+  for(i = 0; i < _c->count; i++) {
+    if(!strcmp(_c->names[i], _f->name)) return _c->symbols[i];
+  }
+
+  return NULL;
+}
+
+static long _xplc_literal(xplc_t* _c, int _i) {
+  const char* b = _c->stmts[_i].param;
+  const char* e = _c->stmts[_i].param_end;
+  char buf[32] = { '\0' };
+  char* conv_suc = NULL;
+  long ret = 0;
+  if(b < e && _xpl_is_dquote(*(unsigned char*)b)) { b++; e--; }
+  if(e <= b || e - b >= (int)sizeof(buf)) _xplc_fail(_c, _i, "integer literal expected");
+  memcpy(buf, b, e - b);
+  ret = strtol(buf, &conv_suc, 0);
+  if(*conv_suc != '\0') _xplc_fail(_c, _i, "integer literal expected");
+
+  return ret;
+}
+
+static void _xplc_indent(xplc_t* _c, int _d) {
+  while(_d-- > 0) fputs("  ", _c->out);
+}
+
+static void _xplc_call(xplc_t* _c, int _i, int _d) {
+  const char* p = NULL;
+  const char* sym = _xplc_symbol(_c, _c->stmts[_i].func);
+  if(!sym) _xplc_fail(_c, _i, "statement can not be translated");
+  _xplc_indent(_c, _d);
+  fprintf(_c->out, "if((ret = xpl_call(_s, %s, \"", sym);
+  for(p = _c->stmts[_i].param; p < _c->stmts[_i].param_end; p++) {
+    switch(*p) {
+      case '"': fputs("\\\"", _c->out); break;
+      case '\\': fputs("\\\\", _c->out); break;
+      case '\n': fputs("\\n", _c->out); break;
+      case '\r': fputs("\\r", _c->out); break;
+      case '\t': fputs("\\t", _c->out); break;
+      default: fputc(*p, _c->out); break;
+    }
+  }
+  fputs("\")) != XS_OK) return ret;\n", _c->out);
+}
+
+static xpl_func_t _xplc_func(xplc_t* _c, int _i) {
+  return _i < _c->stmts_count ? _c->stmts[_i].func->func : NULL;
+}
+
+/* Emits statements from _i until a block keyword, returns its index. */
+static int _xplc_block(xplc_t* _c, int _i, int _d) {
+  xpl_func_t f = NULL;
+  long l = 0;
+  int n = 0;
+  while(_i < _c->stmts_count) {
+    f = _xplc_func(_c, _i);
+    if(f == _xpl_core_if) {
+      n = 0;
+      for(;;) {
+        _i = _xplc_block(_c, _i + 1, _d + n);
+        if(_xplc_func(_c, _i) != _xpl_core_then) _xplc_fail(_c, _i, "'then' expected");
+        _xplc_indent(_c, _d + n); fputs("xpl_pop_bool(_s, &b);\n", _c->out);
+        _xplc_indent(_c, _d + n); fputs("if(b) {\n", _c->out);
+        _i = _xplc_block(_c, _i + 1, _d + n + 1);
+        f = _xplc_func(_c, _i);
+        if(f == _xpl_core_elseif || f == _xpl_core_else) {
+          _xplc_indent(_c, _d + n); fputs("} else {\n", _c->out);
+        }
+        if(f != _xpl_core_elseif) break;
+        n++;
+      }
+      if(f == _xpl_core_else) {
+        _i = _xplc_block(_c, _i + 1, _d + n + 1);
+        f = _xplc_func(_c, _i);
+      }
+      if(f != _xpl_core_endif) _xplc_fail(_c, _i, "'endif' expected");
+      for(; n >= 0; n--) {
+        _xplc_indent(_c, _d + n); fputs("}\n", _c->out);
+      }
+    } else if(f == _xpl_core_while) {
+      _xplc_indent(_c, _d); fputs("for(;;) {\n", _c->out);
+      _i = _xplc_block(_c, _i + 1, _d + 1);
+      if(_xplc_func(_c, _i) != _xpl_core_do) _xplc_fail(_c, _i, "'do' expected");
+      _xplc_indent(_c, _d + 1); fputs("xpl_pop_bool(_s, &b);\n", _c->out);
+      _xplc_indent(_c, _d + 1); fputs("if(!b) break;\n", _c->out);
+      _i = _xplc_block(_c, _i + 1, _d + 1);
+      if(_xplc_func(_c, _i) != _xpl_core_endwhile) _xplc_fail(_c, _i, "'endwhile' expected");
+      _xplc_indent(_c, _d); fputs("}\n", _c->out);
+    } else if(f == _xpl_core_repeat) {
+      l = _xplc_literal(_c, _i);
+      _xplc_indent(_c, _d); fputs("{\n", _c->out);
+      _xplc_indent(_c, _d + 1); fprintf(_c->out, "long n%d = %ldL;\n", _d, l);
+      _xplc_indent(_c, _d + 1); fprintf(_c->out, "for(; n%d > 0; n%d--) {\n", _d, _d);
+      _i = _xplc_block(_c, _i + 1, _d + 2);
+      if(_xplc_func(_c, _i) != _xpl_core_endrepeat) _xplc_fail(_c, _i, "'endrepeat' expected");
+      _xplc_indent(_c, _d + 1); fputs("}\n", _c->out);
+      _xplc_indent(_c, _d); fputs("}\n", _c->out);
+    } else if(f == _xpl_core_switch) {
+      l = _xplc_literal(_c, _i);
+      /* Out of range indexes fail at runtime as the interpreter does, never
+         wrap into a valid one. */
+      if(l < 0 || l >= XPL_REG_COUNT) l = -1;
+      _xplc_indent(_c, _d); fprintf(_c->out, "if((ret = xpl_get_reg(_s, %d, &v)) != XS_OK) return ret;\n", (int)l);
+      _xplc_indent(_c, _d); fputs("switch(v) {\n", _c->out);
+      f = _xplc_func(_c, ++_i);
+      while(f == _xpl_core_case || f == _xpl_core_default) {
+        _xplc_indent(_c, _d + 1);
+        if(f == _xpl_core_case) fprintf(_c->out, "case %ldL: {\n", _xplc_literal(_c, _i));
+        else fputs("default: {\n", _c->out);
+        _i = _xplc_block(_c, _i + 1, _d + 2);
+        _xplc_indent(_c, _d + 1); fputs("} break;\n", _c->out);
+        f = _xplc_func(_c, _i);
+      }
+      if(f != _xpl_core_endswitch) _xplc_fail(_c, _i, "'case', 'default' or 'endswitch' expected");
+      _xplc_indent(_c, _d); fputs("}\n", _c->out);
+    } else if(f == _xpl_core_yield) {
+      _xplc_fail(_c, _i, "'yield' is not supported");
+    } else if(_xplc_symbol(_c, _c->stmts[_i].func)) {
+      _xplc_call(_c, _i, _d);
+    } else {
+      break;
+    }
+    _i++;
+  }
+
+  return _i;
+}
+
+static char* _xplc_read(const char* _f) {
+  FILE* fp = fopen(_f, "rb");
+  char* ret = NULL;
+  long l = 0;
+  if(!fp) return NULL;
+  fseek(fp, 0, SEEK_END);
+  l = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  ret = (char*)malloc(l + 1);
+  l = (long)fread(ret, 1, l, fp);
+  ret[l] = '\0';
+  fclose(fp);
+
+  return ret;
+}
+
+static void _xplc_name(const char* _f, const char* _p, char* _o, int _l) {
+  const char* b = _f;
+  int n = 0;
+  if(strrchr(b, '/')) b = strrchr(b, '/') + 1;
+  for(; *_p && n < _l - 1; _p++) _o[n++] = *_p;
+  if(!n && isdigit(*(unsigned char*)b)) _o[n++] = '_';
+  for(; *b && *b != '.' && n < _l - 1; b++)
+    _o[n++] = isalnum(*(unsigned char*)b) ? *b : '_';
+  _o[n] = '\0';
+}
+
+static void _xplc_translate(xplc_t* _c, xpl_context_t* _s, const char* _t, const char* _n) {
+  xpl_func_info_t* func = NULL;
+  const char* prev = NULL;
+  int cap = 0;
+  int i = 0;
+  _c->stmts_count = 0;
+  xpl_load(_s, _t);
+  for(;;) {
+    XPL_SKIP_MEANINGLESS(_s);
+    if(!*_s->cursor) break;
+    if(_xpl_is_comma(*(unsigned char*)_s->cursor)) { _s->cursor++; continue; }
+    func = NULL;
+    xpl_peek_func(_s, &func);
+    if(!func) {
+      if(!_c->stmts_count) _xplc_fail(_c, 0, "parameter out of statement");
+      prev = _s->cursor;
+      xpl_skip_string(_s);
+      if(_s->cursor == prev) _s->cursor++;
+      _c->stmts[_c->stmts_count - 1].param_end = _s->cursor;
+      continue;
+    }
+    if(_c->stmts_count == cap) {
+      cap = cap ? cap * 2 : 64;
+      _c->stmts = (xplc_stmt_t*)realloc(_c->stmts, cap * sizeof(xplc_stmt_t));
+    }
+    _c->stmts[_c->stmts_count].func = func;
+    _c->stmts[_c->stmts_count].pos = (int)(_s->cursor - _t);
+    _s->cursor += strlen(func->name);
+    XPL_SKIP_MEANINGLESS(_s);
+    _c->stmts[_c->stmts_count].param = _c->stmts[_c->stmts_count].param_end = _s->cursor;
+    _c->stmts_count++;
+  }
+  xpl_unload(_s);
+  fprintf(_c->out, "static xpl_status_t %s(xpl_context_t* _s) {\n", _n);
+  fputs("  xpl_status_t ret = XS_OK;\n  long v = 0;\n  int b = 0;\n", _c->out);
+  fputs("  (void)v; (void)b;\n", _c->out);
+  i = _xplc_block(_c, 0, 1);
+  if(i < _c->stmts_count) _xplc_fail(_c, i, "unexpected statement");
+  fputs("\n  return ret;\n}\n\n", _c->out);
+}
+
+int main(int argc, char* argv[]) {
+  XPL_FUNC_BEGIN_EMPTY(core)
+    XPL_FUNC_CORE
+  XPL_FUNC_END
+  xplc_t c;
+  xpl_config_t g;
+  xpl_context_t s;
+  xpl_func_info_t* funcs = NULL;
+  const char* table = NULL;
+  const char* prefix = "";
+  char** files = NULL;
+  char* text = NULL;
+  char* eq = NULL;
+  char name[128] = { '\0' };
+  int files_count = 0;
+  int core_count = (int)_countof(core) - 1;
+  int i = 0;
+  memset(&c, 0, sizeof(c));
+  c.out = stdout;
+  c.names = (const char**)calloc(argc, sizeof(const char*));
+  c.symbols = (const char**)calloc(argc, sizeof(const char*));
+  files = (char**)calloc(argc, sizeof(char*));
+  for(i = 1; i < argc; i++) {
+    if(!strcmp(argv[i], "-f") && i + 1 < argc) {
+      c.names[c.count] = c.symbols[c.count] = argv[++i];
+      if((eq = strchr(argv[i], '='))) { *eq = '\0'; c.symbols[c.count] = eq + 1; }
+      c.count++;
+    } else if(!strcmp(argv[i], "-p") && i + 1 < argc) {
+      prefix = argv[++i];
+    } else if(!strcmp(argv[i], "-t") && i + 1 < argc) {
+      table = argv[++i];
+    } else if(!strcmp(argv[i], "-o") && i + 1 < argc) {
+      if(!(c.out = fopen(argv[++i], "w"))) { fprintf(stderr, "Can not open %s\n", argv[i]); return 1; }
+    } else if(argv[i][0] == '-') {
+      fprintf(stderr, "Usage: xplc [-f name[=symbol]]... [-p prefix] [-t table] [-o output] script...\n");
+      return 1;
+    } else {
+      files[files_count++] = argv[i];
+    }
+  }
+  funcs = (xpl_func_info_t*)calloc(core_count + c.count + 1, sizeof(xpl_func_info_t));
+  memcpy(funcs, core, core_count * sizeof(xpl_func_info_t));
+  for(i = 0; i < c.count; i++) {
+    funcs[core_count + i].name = c.names[i];
+    funcs[core_count + i].func = _xplc_host;
+  }
+  xpl_config_open(&g, funcs, NULL);
+  g.use_hack_pfunc = 0;
+  xpl_open(&s, &g);
+  fputs("/* Generated by xplc, do not edit. */\n\n", c.out);
+  for(i = 0; i < files_count; i++) {
+    c.file = files[i];
+    if(!(text = _xplc_read(files[i]))) { fprintf(stderr, "Can not read %s\n", files[i]); return 1; }
+    _xplc_name(files[i], prefix, name, sizeof(name));
+    _xplc_translate(&c, &s, text, name);
+    free(text);
+  }
+  if(table) {
+    fprintf(c.out, "static xpl_func_info_t %s[] = {\n", table);
+    for(i = 0; i < files_count; i++) {
+      _xplc_name(files[i], prefix, name, sizeof(name));
+      fprintf(c.out, "  { \"%s\", %s, 0 },\n", name, name);
+    }
+    fputs("  { NULL, NULL, 0 }\n};\n", c.out);
+  }
+  xpl_close(&s);
+  xpl_config_close(&g);
+  if(c.out != stdout) fclose(c.out);
+  free(c.stmts);
+  free(funcs);
+  free(files);
+  free(c.names);
+  free(c.symbols);
+
+  return 0;
+}